@@ -7,8 +7,8 @@ import { useMemo } from 'react';
 
 // CEF 全局函数类型定义
 interface CefQueryRequest {
-  request: string;
-  onSuccess?: (response: string) => void;
+  request: string | ArrayBuffer;
+  onSuccess?: (response: any) => void;
   onFailure?: (errorCode: number, errorMessage: string) => void;
   persistent?: boolean;
 }
@@ -18,6 +18,8 @@ declare global {
   interface Window {
     /** CEF 查询函数，用于调用 IPC 方法 */
     cefQuery?: (request: CefQueryRequest) => number;
+    /** 取消 CEF 查询 */
+    cefQueryCancel?: (queryId: number) => void;
     /** 注册事件监听器 */
     cefEventOn?: (eventName: string, handler: (data: any) => void) => number;
     /** 移除事件监听器 */
@@ -39,12 +41,16 @@ export class Bridge {
    * @param ipcName IPC 方法名称
    * @param params 参数的 JSON 对象
    * @param callback 回调函数，接收响应或错误
+   * @param requestId 可选的幂等请求 ID；后端开启 --request-journal-path 时，
+   *   同一方法、相同 ID 的请求（如渲染进程崩溃重载后重发）直接返回已记录的结果，不会重复执行
+   * @returns 取消调用的函数；后端服务轮询取消标记时会提前停止，取消后不再调用 callback
    */
   invoke(
     ipcName: string,
     params: any,
-    callback?: (errorCode: number | null, errorMessage: string) => void
-  ): void {
+    callback?: (errorCode: number | null, errorMessage: string) => void,
+    requestId?: string
+  ): () => void {
     if (!window.cefQuery) {
       const errorMessage = "cefQuery is not defined.";
       const errorCode = -1;
@@ -53,18 +59,28 @@ export class Bridge {
       } else {
         console.error(`error [${errorCode}]: ${errorMessage}`);
       }
-      return;
+      return () => {};
     }
 
+    let queryId = 0;
+    const cancel = () => {
+      if (queryId && window.cefQueryCancel) {
+        window.cefQueryCancel(queryId);
+      }
+      queryId = 0;
+    };
+
     try {
       const request = JSON.stringify({
         action: ipcName,
         request: JSON.stringify(params),
+        ...(requestId ? { requestId } : {}),
       });
 
-      window.cefQuery({
+      queryId = window.cefQuery({
         request,
         onSuccess: (response: string) => {
+          queryId = 0;
           try {
             if (callback) {
               const result = JSON.parse(response);
@@ -82,6 +98,7 @@ export class Bridge {
           }
         },
         onFailure: (errorCode: number, errorMessage: string) => {
+          queryId = 0;
           if (callback) {
             callback(errorCode, errorMessage);
           } else {
@@ -97,6 +114,130 @@ export class Bridge {
         console.error(`error [${-1}]: ${err.message}`);
       }
     }
+
+    return cancel;
+  }
+
+  /**
+   * 以流式（persistent）方式调用 CEF IPC 方法
+   * 后端会分块返回结果，每块均为 JSON，最后一块带有 done: true
+   * @param ipcName IPC 方法名称
+   * @param params 参数的 JSON 对象
+   * @param onChunk 每收到一块结果时调用
+   * @param callback 结束或出错时调用
+   * @returns 取消调用的函数
+   */
+  invokeStream(
+    ipcName: string,
+    params: any,
+    onChunk: (chunk: any) => void,
+    callback?: (errorCode: number | null, errorMessage: string) => void
+  ): () => void {
+    if (!window.cefQuery) {
+      const errorMessage = "cefQuery is not defined.";
+      const errorCode = -1;
+      if (callback) {
+        callback(errorCode, errorMessage);
+      } else {
+        console.error(`error [${errorCode}]: ${errorMessage}`);
+      }
+      return () => {};
+    }
+
+    let queryId = 0;
+    const cancel = () => {
+      if (queryId && window.cefQueryCancel) {
+        window.cefQueryCancel(queryId);
+      }
+      queryId = 0;
+    };
+
+    queryId = window.cefQuery({
+      request: JSON.stringify({
+        action: ipcName,
+        request: JSON.stringify(params),
+      }),
+      persistent: true,
+      onSuccess: (response: string) => {
+        try {
+          const chunk = JSON.parse(response);
+          onChunk(chunk);
+          if (chunk && chunk.done) {
+            cancel();
+            if (callback) {
+              callback(null, '');
+            }
+          }
+        } catch (error) {
+          cancel();
+          const parseError = error instanceof Error
+            ? error
+            : new Error('Failed to parse response');
+          if (callback) {
+            callback(-1, parseError.message);
+          } else {
+            console.error(`error [${-1}]: ${parseError.message}`);
+          }
+        }
+      },
+      onFailure: (errorCode: number, errorMessage: string) => {
+        queryId = 0;
+        if (callback) {
+          callback(errorCode, errorMessage);
+        } else {
+          console.error(`error [${errorCode}]: ${errorMessage}`);
+        }
+      },
+    });
+
+    return cancel;
+  }
+
+  /**
+   * 以二进制方式调用 CEF IPC 方法
+   * 请求格式：[uint32 小端 action 长度][action UTF-8][payload]
+   * @param ipcName IPC 方法名称
+   * @param payload 二进制参数（如 BSON）
+   * @param callback 回调函数，成功时接收二进制响应
+   */
+  invokeBinary(
+    ipcName: string,
+    payload: ArrayBuffer | Uint8Array,
+    callback?: (errorCode: number | null, result: ArrayBuffer | string) => void
+  ): void {
+    if (!window.cefQuery) {
+      const errorMessage = "cefQuery is not defined.";
+      const errorCode = -1;
+      if (callback) {
+        callback(errorCode, errorMessage);
+      } else {
+        console.error(`error [${errorCode}]: ${errorMessage}`);
+      }
+      return;
+    }
+
+    const action = new TextEncoder().encode(ipcName);
+    const body = payload instanceof Uint8Array ? payload : new Uint8Array(payload);
+    const request = new Uint8Array(4 + action.length + body.length);
+    new DataView(request.buffer).setUint32(0, action.length, true);
+    request.set(action, 4);
+    request.set(body, 4 + action.length);
+
+    window.cefQuery({
+      request: request.buffer,
+      onSuccess: (response: ArrayBuffer) => {
+        if (callback) {
+          callback(null, response);
+        }
+      },
+      onFailure: (errorCode: number, errorMessage: string) => {
+        if (callback) {
+          callback(errorCode, errorMessage);
+        } else {
+          console.error(`error [${errorCode}]: ${errorMessage}`);
+        }
+      },
+    });
   }
 
   /**
@@ -155,11 +296,29 @@ export class Bridge {
   }
 }
 
+/**
+ * 解码 file:read 返回的 data 字段
+ * 文件内容以 base64 传输，因为查询结果以 UTF-16 字符串到达 JS，无法承载非 UTF-8 的字节；
+ * 流式读取时每块单独编码，可逐块解码
+ * @param data base64 字符串
+ * @returns 文件的原始字节
+ */
+export function fromBase64(data: string): Uint8Array {
+  const binary = atob(data);
+  const bytes = new Uint8Array(binary.length);
+  for (let i = 0; i < binary.length; i++) {
+    bytes[i] = binary.charCodeAt(i);
+  }
+  return bytes;
+}
+
 // 导出单例实例，方便直接使用
 export const bridge = new Bridge();
 
 // 导出便捷方法
 export const invoke = bridge.invoke.bind(bridge);
+export const invokeStream = bridge.invokeStream.bind(bridge);
+export const invokeBinary = bridge.invokeBinary.bind(bridge);
 export const on = bridge.on.bind(bridge);
 export const emit = bridge.emit.bind(bridge);
 
@@ -4,6 +4,6 @@ import react from '@vitejs/plugin-react'
 // https://vite.dev/config/
 export default defineConfig({
   plugins: [react()],
-  // 使用相对路径，便于 CEF 在 file:// 协议下正确加载 dist 资源
+  // 使用相对路径，dist 资源由 CEF 在 app://local/ 下从内存提供，也可以直接用 file:// 打开
   base: './',
 })
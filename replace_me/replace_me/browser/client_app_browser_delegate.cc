@@ -12,6 +12,7 @@
 #include "replace_me/browser/default_client_handler.h"
 #include "replace_me/browser/main_context.h"
 #include "replace_me/browser/root_window_manager.h"
+#include "replace_me/browser/startup_trace.h"
 #include "replace_me/common/client_switches.h"
 
 namespace client::browser {
@@ -48,6 +49,14 @@ namespace client::browser {
             // Load the CRLSets file from the specified path.
             CefLoadCRLSetsFile(crl_sets_path);
         }
+
+        const std::string& startup_trace_path =
+            CefCommandLine::GetGlobalCommandLine()->GetSwitchValue(
+                switches::kStartupTracePath);
+        if (!startup_trace_path.empty()) {
+            // Benchmark script parse and compile time until the first page loads.
+            StartupTrace::Get().Begin(startup_trace_path);
+        }
     }
     void ClientBrowserDelegate::OnBeforeCommandLineProcessing(CefRefPtr<ClientAppBrowser> app, CefRefPtr<CefCommandLine> command_line)
     {
@@ -4,10 +4,14 @@
 
 #include "replace_me/browser/client_handler_base.h"
 
+#include "include/base/cef_callback.h"
 #include "include/cef_command_line.h"
+#include "include/wrapper/cef_closure_task.h"
+#include "replace_me/browser/dist_cache.h"
 #include "replace_me/browser/main_context.h"
 #include "replace_me/browser/message_handler.h"
 #include "replace_me/browser/root_window_manager.h"
+#include "replace_me/browser/startup_trace.h"
 #include "replace_me/browser/event_router_browser_side.h"
 #include "replace_me/common/client_switches.h"
 
@@ -15,6 +19,9 @@ namespace client {
 
 ClientHandlerBase::ClientHandlerBase() {
   resource_manager_ = new CefResourceManager();
+  // Serves the frontend bundle on kAppOrigin from memory.
+  resource_manager_->AddProvider(DistCache::CreateProvider(), 0,
+                                 std::string());
 }
 
 // static
@@ -73,8 +80,6 @@ void ClientHandlerBase::OnAfterCreated(CefRefPtr<CefBrowser> browser) {
   message_router = EventRouterBrowserSide::Create(/*config*/);
   message_routers_.insert(message_router);
 
-  // No need to set up resource provider for file:// protocol
-
   if (track_as_other_browser_) {
     MainContext::Get()->GetRootWindowManager()->OtherBrowserCreated(
         browser->GetIdentifier(), browser->GetHost()->GetOpenerIdentifier());
@@ -110,6 +115,27 @@ void ClientHandlerBase::OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
   if (!isLoading && initial_navigation_) {
     initial_navigation_ = false;
   }
+
+  if (!isLoading) {
+    StartupTrace::Get().OnLoadEnd();
+    if (CefCommandLine::GetGlobalCommandLine()->HasSwitch(
+            switches::kWarmCodeCache)) {
+      WarmCodeCache(browser);
+    }
+  }
+}
+
+void ClientHandlerBase::WarmCodeCache(CefRefPtr<CefBrowser> browser) {
+  // V8 only caches the code of a script it has run before, so the page is
+  // loaded until the cache has been written and used once, then closed.
+  if (++warm_code_cache_loads_ < kWarmCodeCacheLoads) {
+    // Give the renderer time to finish the page and hand the produced cache
+    // to the browser process before it is reloaded.
+    CefPostDelayedTask(TID_UI, base::BindOnce(&CefBrowser::Reload, browser),
+                       kWarmCodeCacheDelayMs);
+  } else {
+    browser->GetHost()->CloseBrowser(false);
+  }
 }
 
 bool ClientHandlerBase::OnBeforeBrowse(CefRefPtr<CefBrowser> browser,
@@ -124,6 +124,14 @@ class ClientHandlerBase : public CefClient,
   void set_track_as_other_browser(bool val) { track_as_other_browser_ = val; }
 
  private:
+  // Loads of the page in --warm-code-cache mode before the browser is closed,
+  // and the delay before each reload.
+  static constexpr int kWarmCodeCacheLoads = 3;
+  static constexpr int kWarmCodeCacheDelayMs = 2000;
+
+  // Reloads |browser| until the frontend bundle is in the V8 code cache.
+  void WarmCodeCache(CefRefPtr<CefBrowser> browser);
+
   // True if this handler should call
   // RootWindowManager::OtherBrowser[Created|Closed].
   bool track_as_other_browser_ = true;
@@ -146,6 +154,9 @@ class ClientHandlerBase : public CefClient,
   // True for the initial navigation after browser creation.
   bool initial_navigation_ = true;
 
+  // Loads finished so far in --warm-code-cache mode.
+  int warm_code_cache_loads_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(ClientHandlerBase);
 };
 
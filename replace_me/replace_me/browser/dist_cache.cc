@@ -0,0 +1,549 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#include "replace_me/browser/dist_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "include/base/cef_callback.h"
+#include "include/base/cef_logging.h"
+#include "include/cef_parser.h"
+#include "include/cef_task.h"
+#include "include/wrapper/cef_closure_task.h"
+#include "include/wrapper/cef_helpers.h"
+#include "replace_me/common/app_scheme.h"
+#include "replace_me/common/dist_pack_format.h"
+#include "replace_me/common/file_util.h"
+
+#if defined(REPLACE_ME_USE_BROTLI)
+#include <brotli/decode.h>
+#endif
+
+namespace client {
+
+    namespace {
+
+        constexpr size_t kMaxPreloadThreads = 8;
+
+        std::filesystem::path ToPath(const std::string& utf8) {
+            return std::filesystem::path(std::u8string(utf8.begin(), utf8.end()));
+        }
+
+        std::string ToUtf8(const std::filesystem::path& path) {
+            const std::u8string str = path.generic_u8string();
+            return std::string(str.begin(), str.end());
+        }
+
+        std::string ETagOf(uint64_t hash) {
+            static const char kHex[] = "0123456789abcdef";
+            std::string etag(18, '"');
+            for (int i = 0; i < 16; ++i) {
+                etag[16 - i] = kHex[(hash >> (i * 4)) & 0xf];
+            }
+            return etag;
+        }
+
+        std::string ExtensionOf(const std::string& path) {
+            const size_t slash = path.rfind('/');
+            const size_t dot = path.rfind('.');
+            if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+                return std::string();
+            }
+            return path.substr(dot + 1);
+        }
+
+        std::string MimeTypeOf(const std::string& path) {
+            std::string ext = ExtensionOf(path);
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            std::string mime_type = CefGetMimeType(ext).ToString();
+            if (mime_type.empty()) {
+                mime_type = "application/octet-stream";
+            }
+            if (mime_type.compare(0, 5, "text/") == 0 || ext == "json" || ext == "svg") {
+                mime_type += "; charset=utf-8";
+            }
+            return mime_type;
+        }
+
+        // Vite writes its bundles as assets/<name>-<hash>.<ext>, the hash being
+        // exactly 8 characters of [A-Za-z0-9_-], so a changed file gets a new
+        // URL and the old one can be cached forever. Names outside assets/ or
+        // with a dash that merely happens to be followed by 8 or more
+        // characters (my-component.js) are revalidated.
+        bool IsFingerprinted(const std::string& path) {
+            constexpr size_t kHashLength = 8;
+            if (path.compare(0, 7, "assets/") != 0) {
+                return false;
+            }
+            const std::string name = path.substr(path.rfind('/') + 1);
+            const size_t dot = name.find('.');
+            if (dot == std::string::npos || dot < kHashLength + 2 || name[dot - kHashLength - 1] != '-') {
+                return false;
+            }
+            for (size_t i = dot - kHashLength; i < dot; ++i) {
+                const char c = name[i];
+                if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::shared_ptr<DistCache::Entry> NewEntry(const std::string& path, uint64_t hash) {
+            auto entry = std::make_shared<DistCache::Entry>();
+            entry->etag = ETagOf(hash);
+            entry->mime_type = MimeTypeOf(path);
+            entry->cache_control = IsFingerprinted(path) ? "public, max-age=31536000, immutable" : "no-cache";
+            return entry;
+        }
+
+        // Every path and blob lies within the archive, and the entries are
+        // sorted by path.
+        bool IsValidPack(const MappedFile& file) {
+            const size_t size = file.size();
+            if (size < sizeof(dist_pack::Header)) {
+                return false;
+            }
+            const auto* header = reinterpret_cast<const dist_pack::Header*>(file.data());
+            if (memcmp(header->magic, dist_pack::kMagic, sizeof(dist_pack::kMagic)) != 0 ||
+                header->version != dist_pack::kVersion ||
+                (size - sizeof(dist_pack::Header)) / sizeof(dist_pack::Entry) < header->entry_count ||
+                header->paths_offset > size || header->paths_size > size - header->paths_offset) {
+                return false;
+            }
+            const auto* entries = reinterpret_cast<const dist_pack::Entry*>(header + 1);
+            std::string_view previous;
+            for (uint32_t i = 0; i < header->entry_count; ++i) {
+                const dist_pack::Entry& e = entries[i];
+                if (e.path_offset < header->paths_offset || e.path_size > header->paths_size ||
+                    e.path_offset - header->paths_offset > header->paths_size - e.path_size) {
+                    return false;
+                }
+                for (const dist_pack::Blob& blob : e.blobs) {
+                    if (blob.offset > size || blob.size > size - blob.offset) {
+                        return false;
+                    }
+                }
+                const std::string_view path(reinterpret_cast<const char*>(file.data()) + e.path_offset, e.path_size);
+                if (i > 0 && !(previous < path)) {
+                    return false;
+                }
+                previous = path;
+            }
+            return true;
+        }
+
+        // Path relative to the dist directory of a kAppOrigin |url| without
+        // query or fragment. Empty if the path leaves the directory, also by way
+        // of a Windows drive or stream name (a segment with ':').
+        std::string PathOf(const std::string& url) {
+            std::string path = CefURIDecode(url.substr(sizeof(kAppOrigin) - 1), true,
+                static_cast<cef_uri_unescape_rule_t>(UU_SPACES | UU_URL_SPECIAL_CHARS_EXCEPT_PATH_SEPARATORS)).ToString();
+            if (path.empty() || path.back() == '/') {
+                path += "index.html";
+            }
+            size_t begin = 0;
+            while (begin <= path.size()) {
+                size_t end = path.find('/', begin);
+                if (end == std::string::npos) {
+                    end = path.size();
+                }
+                const std::string segment = path.substr(begin, end - begin);
+                if (segment.empty() || segment == "." || segment == ".." ||
+                    segment.find_first_of("\\:") != std::string::npos) {
+                    return std::string();
+                }
+                begin = end + 1;
+            }
+            return path;
+        }
+
+        // Serves a cached file straight from memory or the archive mapping.
+        //
+        // Chromium neither asks custom scheme handlers for a Content-Encoding
+        // nor decodes their bodies, so the response is always the identity
+        // bytes. With REPLACE_ME_USE_BROTLI they are decoded from the brotli
+        // variant here while Chromium reads them, off the UI thread, which
+        // reads a fraction of the bytes from disk on a cold start.
+        class DistResourceHandler : public CefResourceHandler {
+        public:
+            DistResourceHandler(std::shared_ptr<const DistCache::Entry> entry, const std::string& if_none_match)
+                : entry_(std::move(entry)) {
+                if (!entry_) {
+                    return;
+                }
+#if defined(REPLACE_ME_USE_BROTLI)
+                decode_brotli_ = entry_->brotli.data != nullptr;
+#endif
+                not_modified_ = !if_none_match.empty() && if_none_match.find(entry_->etag) != std::string::npos;
+            }
+
+            ~DistResourceHandler() override {
+#if defined(REPLACE_ME_USE_BROTLI)
+                if (decoder_) {
+                    BrotliDecoderDestroyInstance(decoder_);
+                }
+#endif
+            }
+
+            bool Open(CefRefPtr<CefRequest> request, bool& handle_request, CefRefPtr<CefCallback> callback) override {
+                handle_request = true;
+                return true;
+            }
+
+            void GetResponseHeaders(CefRefPtr<CefResponse> response, int64_t& response_length, CefString& redirectUrl) override {
+                if (!entry_) {
+                    response->SetStatus(404);
+                    response->SetStatusText("Not Found");
+                    response_length = 0;
+                    return;
+                }
+
+                CefResponse::HeaderMap headers;
+                headers.insert(std::make_pair("ETag", entry_->etag));
+                headers.insert(std::make_pair("Cache-Control", entry_->cache_control));
+                response->SetHeaderMap(headers);
+                response->SetMimeType(entry_->mime_type);
+                if (not_modified_) {
+                    response->SetStatus(304);
+                    response->SetStatusText("Not Modified");
+                    response_length = 0;
+                } else {
+                    response->SetStatus(200);
+                    response->SetStatusText("OK");
+                    response_length = static_cast<int64_t>(entry_->size);
+                }
+            }
+
+            bool Read(void* data_out, int bytes_to_read, int& bytes_read, CefRefPtr<CefResourceReadCallback> callback) override {
+                bytes_read = 0;
+                if (!entry_ || not_modified_) {
+                    return false;
+                }
+#if defined(REPLACE_ME_USE_BROTLI)
+                if (decode_brotli_) {
+                    return Decode(data_out, bytes_to_read, bytes_read);
+                }
+#endif
+                bytes_read = static_cast<int>(std::min(entry_->size - offset_, static_cast<size_t>(bytes_to_read)));
+                if (bytes_read <= 0) {
+                    return false;
+                }
+                memcpy(data_out, entry_->data + offset_, bytes_read);
+                offset_ += bytes_read;
+                return true;
+            }
+
+            bool Skip(int64_t bytes_to_skip, int64_t& bytes_skipped, CefRefPtr<CefResourceSkipCallback> callback) override {
+                bytes_skipped = 0;
+                if (!entry_ || not_modified_) {
+                    return false;
+                }
+#if defined(REPLACE_ME_USE_BROTLI)
+                if (decode_brotli_) {
+                    char buffer[16 * 1024];
+                    int bytes_read = 0;
+                    while (bytes_skipped < bytes_to_skip &&
+                           Decode(buffer, static_cast<int>(std::min<int64_t>(sizeof(buffer), bytes_to_skip - bytes_skipped)), bytes_read)) {
+                        bytes_skipped += bytes_read;
+                    }
+                    return bytes_skipped > 0;
+                }
+#endif
+                bytes_skipped = static_cast<int64_t>(std::min(entry_->size - offset_, static_cast<size_t>(bytes_to_skip)));
+                offset_ += static_cast<size_t>(bytes_skipped);
+                return bytes_skipped > 0;
+            }
+
+            void Cancel() override {}
+
+        private:
+#if defined(REPLACE_ME_USE_BROTLI)
+            bool Decode(void* data_out, int bytes_to_read, int& bytes_read) {
+                if (!decoder_) {
+                    decoder_ = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+                    if (!decoder_) {
+                        return false;
+                    }
+                }
+                const DistCache::Blob source = entry_->brotli;
+                size_t available_in = source.size - offset_;
+                const uint8_t* next_in = reinterpret_cast<const uint8_t*>(source.data) + offset_;
+                size_t available_out = static_cast<size_t>(bytes_to_read);
+                uint8_t* next_out = static_cast<uint8_t*>(data_out);
+                const BrotliDecoderResult result =
+                    BrotliDecoderDecompressStream(decoder_, &available_in, &next_in, &available_out, &next_out, nullptr);
+                if (result == BROTLI_DECODER_RESULT_ERROR) {
+                    LOG(ERROR) << "Corrupt brotli variant: "
+                               << BrotliDecoderErrorString(BrotliDecoderGetErrorCode(decoder_));
+                    return false;
+                }
+                offset_ = source.size - available_in;
+                bytes_read = bytes_to_read - static_cast<int>(available_out);
+                return bytes_read > 0;
+            }
+
+            BrotliDecoderState* decoder_ = nullptr;
+            bool decode_brotli_ = false;
+#endif
+
+            const std::shared_ptr<const DistCache::Entry> entry_;
+            bool not_modified_ = false;
+            size_t offset_ = 0;
+
+            IMPLEMENT_REFCOUNTING(DistResourceHandler);
+            DISALLOW_COPY_AND_ASSIGN(DistResourceHandler);
+        };
+
+        // Reads a file that was not cached yet and answers |request| with it.
+        // Unknown extension-less paths are client side routes of the single
+        // page app and get index.html.
+        void LoadAndContinue(scoped_refptr<CefResourceManager::Request> request, const std::string& path, const std::string& if_none_match) {
+            std::shared_ptr<const DistCache::Entry> entry = DistCache::Get().Load(path);
+            if (!entry && ExtensionOf(path).empty()) {
+                entry = DistCache::Get().Load("index.html");
+            }
+            request->Continue(new DistResourceHandler(std::move(entry), if_none_match));
+        }
+
+        class DistProvider : public CefResourceManager::Provider {
+        public:
+            DistProvider() = default;
+
+            bool OnRequest(scoped_refptr<CefResourceManager::Request> request) override {
+                CEF_REQUIRE_IO_THREAD();
+
+                const std::string& url = request->url();
+                if (url.compare(0, sizeof(kAppOrigin) - 1, kAppOrigin) != 0) {
+                    // Not handled by this provider.
+                    return false;
+                }
+
+                const std::string path = PathOf(url);
+                const std::string if_none_match = request->request()->GetHeaderByName("If-None-Match").ToString();
+                if (path.empty()) {
+                    request->Continue(new DistResourceHandler(nullptr, if_none_match));
+                    return true;
+                }
+
+                if (std::shared_ptr<const DistCache::Entry> entry = DistCache::Get().Find(path)) {
+                    request->Continue(new DistResourceHandler(std::move(entry), if_none_match));
+                } else {
+                    CefPostTask(TID_FILE_USER_BLOCKING, base::BindOnce(&LoadAndContinue, request, path, if_none_match));
+                }
+                return true;
+            }
+
+        private:
+            DISALLOW_COPY_AND_ASSIGN(DistProvider);
+        };
+
+    }  // namespace
+
+    // static
+    DistCache& DistCache::Get() {
+        static DistCache s_cache;
+        return s_cache;
+    }
+
+    void DistCache::Preload(const std::string& dir) {
+        auto pack = std::make_shared<MappedFile>();
+        if (!pack->Open(dir + ".pack", MappedFile::Mode::kReadOnly)) {
+            pack.reset();
+        } else if (!IsValidPack(*pack)) {
+            LOG(ERROR) << "Ignoring corrupt " << dir << ".pack";
+            pack.reset();
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            dir_ = dir;
+            pack_ = pack;
+        }
+        if (pack) {
+            CefPostTask(TID_FILE_USER_VISIBLE, base::BindOnce(&DistCache::PreloadPack, base::Unretained(this)));
+        } else {
+            CefPostTask(TID_FILE_USER_VISIBLE, base::BindOnce(&DistCache::PreloadAll, base::Unretained(this)));
+        }
+    }
+
+    std::shared_ptr<const DistCache::Entry> DistCache::Load(const std::string& path) {
+        if (std::shared_ptr<const Entry> entry = Find(path)) {
+            return entry;
+        }
+        std::shared_ptr<const MappedFile> pack;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            pack = pack_;
+        }
+        return pack ? ReadPack(path) : Read(path);
+    }
+
+    std::shared_ptr<const DistCache::Entry> DistCache::Find(const std::string& path) const {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto it = entries_.find(path);
+        return it != entries_.end() ? it->second : nullptr;
+    }
+
+    // static
+    CefResourceManager::Provider* DistCache::CreateProvider() {
+        return new DistProvider();
+    }
+
+    std::shared_ptr<const DistCache::Entry> DistCache::Read(const std::string& path) {
+        std::string dir;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            dir = dir_;
+        }
+        if (dir.empty()) {
+            return nullptr;
+        }
+
+        // PathOf already keeps |path| inside the directory; check the joined
+        // path as well, operator/ replaces the base with an absolute operand.
+        std::filesystem::path root = ToPath(dir).lexically_normal();
+        if (!root.has_filename()) {
+            root = root.parent_path();
+        }
+        const std::filesystem::path file = (root / ToPath(path)).lexically_normal();
+        if (std::mismatch(root.begin(), root.end(), file.begin(), file.end()).first != root.end()) {
+            return nullptr;
+        }
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(file, ec)) {
+            return nullptr;
+        }
+        auto body = std::make_shared<std::string>();
+        if (!file_util::ReadFileToString(ToUtf8(file), body.get())) {
+            LOG(ERROR) << "Failed to read " << ToUtf8(file);
+            return nullptr;
+        }
+
+        const uint64_t hash = dist_pack::HashOf(body->data(), body->size());
+        std::shared_ptr<Entry> entry = NewEntry(path, hash);
+
+        std::lock_guard<std::mutex> guard(lock_);
+        auto it = entries_.find(path);
+        if (it != entries_.end()) {
+            // Read by another thread in the meantime.
+            return it->second;
+        }
+        std::shared_ptr<const std::string> shared = bodies_[hash].lock();
+        if (!shared || *shared != *body) {
+            shared = body;
+            bodies_[hash] = shared;
+        }
+        entry->data = shared->data();
+        entry->size = shared->size();
+        entry->owner = std::move(shared);
+        entries_[path] = entry;
+        return entry;
+    }
+
+    std::shared_ptr<const DistCache::Entry> DistCache::ReadPack(const std::string& path) {
+        std::shared_ptr<const MappedFile> pack;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            pack = pack_;
+        }
+        const char* base = reinterpret_cast<const char*>(pack->data());
+        const auto* header = reinterpret_cast<const dist_pack::Header*>(base);
+        const auto* begin = reinterpret_cast<const dist_pack::Entry*>(header + 1);
+        const auto* end = begin + header->entry_count;
+        auto path_of = [base](const dist_pack::Entry& e) {
+            return std::string_view(base + e.path_offset, e.path_size);
+        };
+        const auto* it = std::lower_bound(begin, end, std::string_view(path),
+            [&path_of](const dist_pack::Entry& e, std::string_view key) { return path_of(e) < key; });
+        if (it == end || path_of(*it) != path) {
+            return nullptr;
+        }
+
+        std::shared_ptr<Entry> entry = NewEntry(path, it->hash);
+        entry->owner = pack;
+        entry->data = base + it->blobs[dist_pack::kIdentity].offset;
+        entry->size = static_cast<size_t>(it->blobs[dist_pack::kIdentity].size);
+        if (it->blobs[dist_pack::kBrotli].offset != 0) {
+            entry->brotli = Blob{ base + it->blobs[dist_pack::kBrotli].offset, static_cast<size_t>(it->blobs[dist_pack::kBrotli].size) };
+        }
+
+        std::lock_guard<std::mutex> guard(lock_);
+        auto inserted = entries_.emplace(path, entry);
+        return inserted.first->second;
+    }
+
+    void DistCache::PreloadPack() {
+        const auto start = std::chrono::steady_clock::now();
+
+        std::string dir;
+        std::shared_ptr<const MappedFile> pack;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            dir = dir_;
+            pack = pack_;
+        }
+        const char* base = reinterpret_cast<const char*>(pack->data());
+        const auto* header = reinterpret_cast<const dist_pack::Header*>(base);
+        const auto* entries = reinterpret_cast<const dist_pack::Entry*>(header + 1);
+        for (uint32_t i = 0; i < header->entry_count; ++i) {
+            Load(std::string(base + entries[i].path_offset, entries[i].path_size));
+        }
+
+        LOG(INFO) << "Indexed " << header->entry_count << " files of " << dir << ".pack in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()
+                  << " us";
+    }
+
+    void DistCache::PreloadAll() {
+        const auto start = std::chrono::steady_clock::now();
+
+        std::string dir;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            dir = dir_;
+        }
+        const std::filesystem::path root = ToPath(dir);
+        std::vector<std::string> paths;
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+            std::error_code size_ec;
+            if (it->is_regular_file(size_ec) && it->file_size(size_ec) <= kMaxPreloadFileSize && !size_ec) {
+                paths.push_back(ToUtf8(it->path().lexically_relative(root)));
+            }
+        }
+        if (paths.empty()) {
+            return;
+        }
+
+        std::atomic<size_t> next{ 0 };
+        auto worker = [this, &paths, &next]() {
+            for (size_t i = next++; i < paths.size(); i = next++) {
+                Load(paths[i]);
+            }
+        };
+        const size_t count = std::min<size_t>({ kMaxPreloadThreads, paths.size(),
+            std::max(1u, std::thread::hardware_concurrency()) });
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        LOG(INFO) << "Preloaded " << paths.size() << " files of " << dir << " in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()
+                  << " ms";
+    }
+
+}  // namespace client
@@ -0,0 +1,96 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_BROWSER_DIST_CACHE_H_
+#define REPLACE_ME_BROWSER_DIST_CACHE_H_
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "include/wrapper/cef_resource_manager.h"
+#include "replace_me/common/mapped_file.h"
+
+namespace client {
+
+    ///
+    /// In-memory cache of the frontend dist directory, served on kAppOrigin.
+    ///
+    /// Files are keyed by their path relative to the directory and point to a
+    /// body keyed by its content hash, so identical files share one copy. The
+    /// hash is the strong ETag of the response, and the MIME type and cache
+    /// headers are worked out once when the file is loaded. Fingerprinted
+    /// Vite output (assets/name-<hash>.ext) is marked immutable; other files,
+    /// index.html included, are revalidated and answered with 304 on a match.
+    ///
+    /// When the build packed the directory into <dir>.pack (see
+    /// tools/dist_pack.cc) the archive is mapped instead: responses point into
+    /// the mapping and the ETags come from the hashes stored in it, so startup
+    /// opens one file and reads nothing but its index. Builds with
+    /// OPTION_USE_BROTLI pack brotli variants and decode them while serving,
+    /// see DistResourceHandler.
+    ///
+    /// Otherwise Preload() reads the whole directory on a pool of threads at
+    /// startup. Files that are requested before they are cached, or that are
+    /// too large to preload, are read on the FILE_USER_BLOCKING thread.
+    /// Thread-safe.
+    ///
+    class DistCache {
+    public:
+        // Files larger than this are only read when requested.
+        static constexpr size_t kMaxPreloadFileSize = 16 * 1024 * 1024;
+
+        struct Blob {
+            const char* data = nullptr;
+            size_t size = 0;
+        };
+
+        struct Entry {
+            // Keeps the bytes alive: the file contents or the mapped archive.
+            std::shared_ptr<const void> owner;
+            const char* data = nullptr;
+            size_t size = 0;
+            // Brotli variant from dist.pack, null data if absent.
+            Blob brotli;
+            std::string etag;           // quoted, e.g. "\"9f3c...\""
+            std::string mime_type;
+            std::string cache_control;
+        };
+
+        static DistCache& Get();
+
+        // Sets the directory served and starts reading it in the background.
+        // Called once after CefInitialize, before any browser is created.
+        void Preload(const std::string& dir);
+
+        // Returns the cached file at |path| (relative, '/' separated), reading
+        // it from disk if needed. Returns nullptr if the file does not exist.
+        // Must not be called on the UI or IO thread.
+        std::shared_ptr<const Entry> Load(const std::string& path);
+
+        // Returns the cached file at |path| or nullptr if it has not been read.
+        std::shared_ptr<const Entry> Find(const std::string& path) const;
+
+        // Creates a provider for CefResourceManager that answers kAppOrigin.
+        static CefResourceManager::Provider* CreateProvider();
+
+    private:
+        DistCache() = default;
+
+        std::shared_ptr<const Entry> Read(const std::string& path);
+        std::shared_ptr<const Entry> ReadPack(const std::string& path);
+        void PreloadAll();
+        void PreloadPack();
+
+        std::string dir_;
+        std::shared_ptr<const MappedFile> pack_;
+        mutable std::mutex lock_;
+        std::unordered_map<std::string, std::shared_ptr<const Entry>> entries_;
+        std::unordered_map<uint64_t, std::weak_ptr<const std::string>> bodies_;
+    };
+
+}  // namespace client
+
+#endif  // REPLACE_ME_BROWSER_DIST_CACHE_H_
@@ -9,6 +9,11 @@
 
 #include "include/cef_parser.h"
 #include "replace_me/browser/client_app_browser.h"
+#include "replace_me/browser/dist_cache.h"
+#include "replace_me/browser/query_metrics.h"
+#include "replace_me/browser/query_pool.h"
+#include "replace_me/browser/request_journal.h"
+#include "replace_me/common/app_scheme.h"
 #include "replace_me/common/client_switches.h"
 #include "replace_me/common/string_util.h"
 #include <filesystem>
@@ -158,12 +163,8 @@ std::string MainContextImpl::GetMainURL(
   // Debug mode: use localhost (NDEBUG not defined = Debug build, cross-platform)
   std::string main_url = kDefaultUrl;
 #else
-  // Release: build dist/index.html path
-  std::filesystem::path dist_path(GetAppWorkingDirectory());
-  dist_path /= "dist";
-  dist_path /= "index.html";
-  // Add file:// prefix
-  std::string main_url = "file:///" + dist_path.string();
+  // Release: dist/index.html, served from memory by DistCache
+  std::string main_url = std::string(kAppOrigin) + "index.html";
 #endif
   
   if (command_line->HasSwitch(switches::kUrl)) {
@@ -199,8 +200,16 @@ bool MainContextImpl::UseDefaultPopup() {
 void MainContextImpl::PopulateSettings(CefSettings* settings) {
   client::ClientAppBrowser::PopulateSettings(command_line_, *settings);
 
-  CefString(&settings->cache_path) =
-      command_line_->GetSwitchValue(switches::kCachePath);
+  // Without a cache directory CEF keeps everything in memory and the V8 code
+  // cache of the frontend bundle is lost on exit, so default to a per-user
+  // one. The cache path must be the root cache path or a child of it.
+  std::string cache_path =
+      command_line_->GetSwitchValue(switches::kCachePath).ToString();
+  if (cache_path.empty()) {
+    cache_path = GetDefaultCachePath();
+  }
+  CefString(&settings->cache_path) = cache_path;
+  CefString(&settings->root_cache_path) = cache_path;
 
   if (use_windowless_rendering_) {
     settings->windowless_rendering_enabled = true;
@@ -284,6 +293,19 @@ bool MainContextImpl::Initialize(const CefMainArgs& args,
   root_window_manager_ =
       std::make_unique<RootWindowManager>(terminate_when_all_windows_closed_);
 
+  // Start reading the frontend bundle while the first window is created.
+  if (GetMainURL(nullptr).rfind(kAppOrigin, 0) == 0) {
+    std::filesystem::path dist_path(GetAppWorkingDirectory());
+    dist_path /= "dist";
+    DistCache::Get().Preload(dist_path.string());
+  }
+
+  // Journal bridge queries that carry a requestId if requested.
+  if (command_line_->HasSwitch(switches::kRequestJournalPath)) {
+    message_handler::RequestJournal::Get().Open(
+        command_line_->GetSwitchValue(switches::kRequestJournalPath).ToString());
+  }
+
   initialized_ = true;
 
   return true;
@@ -296,6 +318,17 @@ void MainContextImpl::Shutdown() {
 
   root_window_manager_.reset();
 
+  // Wait for the service queries that are still running, so that exiting
+  // does not cut off a file:write halfway.
+  message_handler::QueryPool::Get().Shutdown();
+  message_handler::RequestJournal::Get().Close();
+
+  // Persist bridge query metrics if requested.
+  if (command_line_->HasSwitch(switches::kQueryMetricsPath)) {
+    message_handler::QueryMetrics::Get().DumpToFile(
+        command_line_->GetSwitchValue(switches::kQueryMetricsPath).ToString());
+  }
+
   CefShutdown();
 
   shutdown_ = true;
@@ -55,6 +55,10 @@ class MainContextImpl : public MainContext {
 
   ~MainContextImpl() override;
 
+  // Returns the per-user cache directory used when --cache-path is not set,
+  // or an empty string if there is none.
+  static std::string GetDefaultCachePath();
+
   // Returns true if the context is in a valid state (initialized and not yet
   // shut down).
   bool InValidState() const { return initialized_ && !shutdown_; }
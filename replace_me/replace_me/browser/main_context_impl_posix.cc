@@ -4,6 +4,7 @@
 
 #include "tests/cefclient/browser/main_context_impl.h"
 
+#include <stdlib.h>
 #include <unistd.h>
 
 namespace client {
@@ -12,6 +13,22 @@ std::string MainContextImpl::GetDownloadPath(const std::string& file_name) {
   return std::string();
 }
 
+// static
+std::string MainContextImpl::GetDefaultCachePath() {
+  const char* home = getenv("HOME");
+#if defined(OS_MAC)
+  return home && *home ? std::string(home) + "/Library/Caches/replace_me"
+                       : std::string();
+#else
+  const char* cache_home = getenv("XDG_CACHE_HOME");
+  if (cache_home && *cache_home) {
+    return std::string(cache_home) + "/replace_me";
+  }
+  return home && *home ? std::string(home) + "/.cache/replace_me"
+                       : std::string();
+#endif
+}
+
 std::string MainContextImpl::GetAppWorkingDirectory() {
   char szWorkingDir[256];
   if (getcwd(szWorkingDir, sizeof(szWorkingDir) - 1) == nullptr) {
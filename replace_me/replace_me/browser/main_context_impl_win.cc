@@ -23,6 +23,21 @@ std::string MainContextImpl::GetDownloadPath(const std::string& file_name) {
   return path;
 }
 
+// static
+std::string MainContextImpl::GetDefaultCachePath() {
+  TCHAR szFolderPath[MAX_PATH];
+  std::string path;
+
+  // Keep the cache in the user's local (non-roaming) application data folder.
+  if (SUCCEEDED(SHGetFolderPath(nullptr, CSIDL_LOCAL_APPDATA | CSIDL_FLAG_CREATE,
+                                nullptr, 0, szFolderPath))) {
+    path = CefString(szFolderPath);
+    path += "\\replace_me\\cache";
+  }
+
+  return path;
+}
+
 std::string MainContextImpl::GetAppWorkingDirectory() {
   char szWorkingDir[MAX_PATH + 1];
   if (_getcwd(szWorkingDir, MAX_PATH) == nullptr) {
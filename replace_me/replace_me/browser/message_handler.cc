@@ -2,23 +2,40 @@
 
 #include "replace_me/browser/message_handler.h"
 
+#include <atomic>
 #include <sstream>
+#include <string_view>
+#include "include/base/cef_callback.h"
 #include "include/base/cef_logging.h"
+#include "include/wrapper/cef_closure_task.h"
 #include "include/wrapper/cef_helpers.h"
+#include "include/cef_task.h"
 #include "include/cef_values.h"
 #include "include/cef_parser.h"
 #include "include/cef_dialog_handler.h"
 #include "xpack.h"
 #include "json.h"
+#include "replace_me/browser/main_context.h"
+#include "replace_me/browser/query_metrics.h"
+#include "replace_me/browser/query_pool.h"
+#include "replace_me/browser/request_journal.h"
+#include "replace_me/common/app_scheme.h"
+#include "replace_me/common/event_notify.h"
+#include "replace_me/common/json_sink.h"
+#include "replace_me/services/file_service.h"
 #include "replace_me/services/test_service.h"
 
 namespace client::message_handler
 {
+    // Decoded in situ; the views point into the request text.
     struct CefQueryMessage
     {
-        std::string action;
+        std::string_view action;
         std::string request;
-        XPACK(O(action, request));
+        // Optional client id; queries carrying one are journaled when
+        // --request-journal-path is set.
+        std::string_view requestId;
+        XPACK(O(action, request, requestId));
     };
 
     struct CefFileDialogRequest
@@ -35,6 +52,214 @@ namespace client::message_handler
         XPACK(O(selectedPath));
     };
 
+    using Clock = std::chrono::steady_clock;
+
+    // Returns the service responsible for |action|, or nullptr if none.
+    static IService* GetService(std::string_view action)
+    {
+        if (action.find("test:") != std::string_view::npos)
+            return &test::TestService::getInstance();
+        if (action.find("file:") != std::string_view::npos)
+            return &file::FileService::getInstance();
+        return nullptr;
+    }
+
+    // Returns true if |frame| shows the frontend itself: a page on kAppOrigin,
+    // or in debug builds one on the origin of the main URL (the dev server).
+    static bool IsAppFrame(CefRefPtr<CefFrame> frame)
+    {
+        CefURLParts parts;
+        if (!frame || !CefParseURL(frame->GetURL(), parts))
+            return false;
+        const std::string origin = CefString(&parts.origin).ToString();
+        if (origin == kAppOrigin)
+            return true;
+#ifndef NDEBUG
+        CefURLParts mainParts;
+        if (CefParseURL(MainContext::Get()->GetMainURL(nullptr), mainParts))
+            return origin == CefString(&mainParts.origin).ToString();
+#endif
+        return false;
+    }
+
+    // Forwards the results of an asynchronous service query to the query
+    // callback. May be used from any thread; results are delivered on the UI
+    // thread.
+    class AsyncQueryResponder : public QueryResponder, public std::enable_shared_from_this<AsyncQueryResponder>
+    {
+    public:
+        AsyncQueryResponder(CefRefPtr<CefMessageRouterBrowserSide::Callback> callback,
+                            bool persistent,
+                            const CancellationToken& token,
+                            ActionMetrics& metrics,
+                            const std::string& action,
+                            const std::string& request_id,
+                            base::OnceClosure on_done)
+            : callback_(callback), persistent_(persistent), token_(token), metrics_(metrics), action_(action), request_id_(request_id), start_(Clock::now()), on_done_(std::move(on_done)) {}
+
+        ~AsyncQueryResponder() override
+        {
+            // A service that never answered must not leave retries of a
+            // journaled query waiting for it.
+            if (!completed_ && !request_id_.empty())
+                CefPostTask(TID_UI, base::BindOnce(&AsyncQueryResponder::Unanswered, action_, request_id_));
+        }
+
+        bool streaming() const override { return persistent_; }
+
+        // Encode time of the query, see ResponseEncodeTime.
+        std::atomic<int64_t>& encode_time() { return encode_time_; }
+
+        // Called once the service call has returned with the token it was
+        // given. A service that gives up on a cancelled query returns without
+        // a result, which still completes the query here so it is counted as
+        // cancelled. Journaled queries get a token that is never cancelled.
+        void ServiceReturned(const CancellationToken& service_token)
+        {
+            if (service_token.isCancelled() && !completed_.exchange(true))
+                CefPostTask(TID_UI, base::BindOnce(&AsyncQueryResponder::Cancelled, shared_from_this()));
+        }
+
+        void chunk(const std::string& response) override
+        {
+            if (persistent_)
+                CefPostTask(TID_UI, base::BindOnce(&AsyncQueryResponder::SendChunk, shared_from_this(), response));
+        }
+
+        void success(const std::string& response) override
+        {
+            if (!completed_.exchange(true))
+                CefPostTask(TID_UI, base::BindOnce(&AsyncQueryResponder::Complete, shared_from_this(), 0, response, std::string()));
+        }
+
+        void failure(int code, const std::string& message) override
+        {
+            if (!completed_.exchange(true))
+                CefPostTask(TID_UI, base::BindOnce(&AsyncQueryResponder::Complete, shared_from_this(), code, std::string(), message));
+        }
+
+        void progress(const std::string& eventName, const std::string& data) override
+        {
+            CefPostTask(TID_UI, base::BindOnce(&AsyncQueryResponder::EmitProgress, eventName, data));
+        }
+
+    private:
+        static void SendChunk(std::shared_ptr<AsyncQueryResponder> self, const std::string& response)
+        {
+            CEF_REQUIRE_UI_THREAD();
+            if (!self->token_.isCancelled())
+                self->callback_->Success(response);
+        }
+
+        static void Complete(std::shared_ptr<AsyncQueryResponder> self, int code, const std::string& response, const std::string& message)
+        {
+            CEF_REQUIRE_UI_THREAD();
+            self->RecordLatency();
+            // Journal the result even if the renderer went away, so the reloaded
+            // page gets it when it retries.
+            if (!self->request_id_.empty())
+                RequestJournal::Get().Record(self->action_, self->request_id_, code, code == 0 ? response : message);
+            if (self->token_.isCancelled())
+            {
+                self->metrics_.RecordCancelled();
+                return;
+            }
+
+            if (code == 0)
+                self->callback_->Success(response);
+            else
+                self->callback_->Failure(code, message);
+            self->metrics_.RecordResult(code);
+        }
+
+        static void Cancelled(std::shared_ptr<AsyncQueryResponder> self)
+        {
+            CEF_REQUIRE_UI_THREAD();
+            self->RecordLatency();
+            self->metrics_.RecordCancelled();
+        }
+
+        // Splits the time since the query was posted into execute and encode.
+        void RecordLatency()
+        {
+            if (on_done_)
+                std::move(on_done_).Run();
+            const Clock::duration encode(encode_time_.load(std::memory_order_relaxed));
+            metrics_.execute.Record(Clock::now() - start_ - encode);
+            metrics_.encode.Record(encode);
+        }
+
+        static void Unanswered(const std::string& action, const std::string& request_id)
+        {
+            CEF_REQUIRE_UI_THREAD();
+            RequestJournal::Get().Record(action, request_id, -1, "Query was not answered");
+        }
+
+        static void EmitProgress(const std::string& eventName, const std::string& data)
+        {
+            CEF_REQUIRE_UI_THREAD();
+            event::EventNotifier::getInstance().emit(eventName, data);
+        }
+
+        CefRefPtr<CefMessageRouterBrowserSide::Callback> callback_;
+        const bool persistent_;
+        CancellationToken token_;
+        ActionMetrics& metrics_;
+        const std::string action_;
+        const std::string request_id_;
+        const Clock::time_point start_;
+        base::OnceClosure on_done_;
+        std::atomic<bool> completed_{ false };
+        std::atomic<int64_t> encode_time_{ 0 };
+    };
+
+    // Runs an asynchronous service query off the UI thread.
+    static void RunServiceQueryAsync(IService* service,
+        const std::string& action,
+        const std::string& request,
+        std::shared_ptr<AsyncQueryResponder> responder,
+        const CancellationToken& token)
+    {
+        DCHECK(QueryPool::RunsTasksOnCurrentThread());
+        ResponseEncodeTime::Scope encodeScope(responder->encode_time());
+        try
+        {
+            service->onQueryAsync(action, request, responder, token);
+        }
+        catch (const std::exception& e)
+        {
+            responder->failure(-1, e.what());
+        }
+        responder->ServiceReturned(token);
+    }
+
+    // Runs a cancellable synchronous service query off the UI thread, so the
+    // token can be cancelled while onQuery() is busy.
+    static void RunServiceQueryCancellable(IService* service,
+        const std::string& action,
+        const std::string& request,
+        std::shared_ptr<AsyncQueryResponder> responder,
+        const CancellationToken& token)
+    {
+        DCHECK(QueryPool::RunsTasksOnCurrentThread());
+        ResponseEncodeTime::Scope encodeScope(responder->encode_time());
+        std::string response;
+        std::string errorMessage;
+        int errorCode = -1;
+        try
+        {
+            errorCode = service->onQuery(action, request, response, errorMessage, token);
+        }
+        catch (const std::exception& e)
+        {
+            errorMessage = e.what();
+        }
+        if (errorCode == 0)
+            responder->success(response);
+        else
+            responder->failure(errorCode, errorMessage);
+    }
+
     bool MessageHandler::OnQuery(CefRefPtr<CefBrowser> browser,
         CefRefPtr<CefFrame> frame,
         int64_t query_id,
@@ -44,59 +269,240 @@ namespace client::message_handler
     {
         CEF_REQUIRE_UI_THREAD();
 
+        const auto decodeStart = Clock::now();
+        // The envelope is parsed in place: action and requestId are views into
+        // |text|, and only the payload is copied out for the service. The
+        // document lives in the UI thread's arena. Malformed messages fail the
+        // query without throwing.
+        xpack::JsonInsitu text(request.ToString());
         CefQueryMessage queryMessage;
-        xpack::json::decode(request.ToString(), queryMessage);
+        const xpack::DecodeResult decoded = xpack::json::try_decode(text, queryMessage, xpack::JsonArena::Local());
+        if (!decoded)
+        {
+            callback->Failure(-1, "Malformed query: " + decoded.Message());
+            return true;
+        }
+
+        ActionMetrics& metrics = QueryMetrics::Get().ForAction(queryMessage.action);
+        metrics.decode.Record(Clock::now() - decodeStart);
+
+        if (queryMessage.action == "cef:metrics")
+        {
+            callback->Success(QueryMetrics::Get().ToJson());
+            metrics.RecordResult(0);
+            return true;
+        }
+
+        const std::string action(queryMessage.action);
+        IService* service = GetService(action);
+        // Checked before the journal, which would hand out recorded results.
+        if (service && service->isPrivileged(action) && !IsAppFrame(frame))
+        {
+            callback->Failure(-1, "Action not allowed from this origin: " + action);
+            metrics.RecordResult(-1);
+            return true;
+        }
+
+        // Streaming results and file dialogs cannot be replayed meaningfully.
+        const bool journaled = !persistent && !queryMessage.requestId.empty() &&
+            queryMessage.action != "cef:selectFolder" && RequestJournal::Get().IsOpen();
+        const std::string requestId = journaled ? std::string(queryMessage.requestId) : std::string();
+        if (journaled && RequestJournal::Get().Replay(action, requestId, callback))
+            return true;
+
+        CancellationToken token;
 
         // Handle file dialog requests asynchronously
         if (queryMessage.action == "cef:selectFolder")
         {
-            HandleFileDialog(browser, queryMessage.request, callback);
+            pending_queries_.emplace(query_id, token);
+            HandleFileDialog(browser, queryMessage.request, callback, query_id, token);
+        }
+        else if (service && (service->isAsync(action) || service->isCancellable(action)))
+        {
+            // Long-running and cancellable service work runs on the QueryPool
+            // so the UI thread stays responsive and OnQueryCanceled can reach
+            // the token while the work runs.
+            pending_queries_.emplace(query_id, token);
+            std::shared_ptr<AsyncQueryResponder> responder = std::make_shared<AsyncQueryResponder>(callback, persistent, token, metrics,
+                action, requestId,
+                base::BindOnce(&MessageHandler::FinishQuery, weak_ptr_factory_.GetWeakPtr(), query_id));
+            // A journaled query runs to completion even if it is canceled, e.g.
+            // because the renderer crashed, so its result can be replayed.
+            const CancellationToken serviceToken = journaled ? CancellationToken() : token;
+            if (service->isAsync(action))
+            {
+                QueryPool::Get().Post(base::BindOnce(&RunServiceQueryAsync, service,
+                    action, queryMessage.request, responder, serviceToken));
+            }
+            else
+            {
+                QueryPool::Get().Post(base::BindOnce(&RunServiceQueryCancellable, service,
+                    action, queryMessage.request, responder, serviceToken));
+            }
         }
         else
         {
-            // Handle other requests synchronously
-            CefString response;
-            CefString errorMessage;
-            if (int errorCode = OnQueryInternal(request, response, errorMessage); errorCode == 0)
+            // Handle other requests synchronously. They cannot be canceled while
+            // they run on the UI thread, so they are not tracked.
+            const auto executeStart = Clock::now();
+            std::atomic<int64_t> encodeTime{ 0 };
+            std::string response;
+            std::string errorMessage;
+            int errorCode = -1;
+            {
+                ResponseEncodeTime::Scope encodeScope(encodeTime);
+                // A throwing service still has to reach Record below, or
+                // retries of a journaled query would wait for it forever.
+                try
+                {
+                    errorCode = OnQueryInternal(service, action, queryMessage.request, response, errorMessage, token);
+                }
+                catch (const std::exception& e)
+                {
+                    errorCode = -1;
+                    errorMessage = e.what();
+                }
+            }
+            const Clock::duration encode(encodeTime.load(std::memory_order_relaxed));
+            metrics.execute.Record(Clock::now() - executeStart - encode);
+            metrics.encode.Record(encode);
+            if (journaled)
+                RequestJournal::Get().Record(action, requestId, errorCode, errorCode == 0 ? response : errorMessage);
+
+            if (errorCode == 0)
                 callback->Success(response);
             else
                 callback->Failure(errorCode, errorMessage);
+            metrics.RecordResult(errorCode);
         }
 
         return true;
     }
 
-    int MessageHandler::OnQueryInternal(const CefString& request, CefString& response, CefString& error_message)
+    bool MessageHandler::OnQuery(CefRefPtr<CefBrowser> browser,
+        CefRefPtr<CefFrame> frame,
+        int64_t query_id,
+        CefRefPtr<const CefBinaryBuffer> request,
+        bool persistent,
+        CefRefPtr<Callback> callback)
     {
+        CEF_REQUIRE_UI_THREAD();
 
-        std::string resp;
-        std::string errorMsg;
-        int ret = 0;
+        const auto decodeStart = Clock::now();
+        const uint8_t* data = static_cast<const uint8_t*>(request->GetData());
+        const size_t size = request->GetSize();
 
-        CefQueryMessage queryMessage;
-        xpack::json::decode(request.ToString(), queryMessage);
+        uint32_t actionLength = 0;
+        if (size >= sizeof(actionLength))
+        {
+            actionLength = static_cast<uint32_t>(data[0])
+                | (static_cast<uint32_t>(data[1]) << 8)
+                | (static_cast<uint32_t>(data[2]) << 16)
+                | (static_cast<uint32_t>(data[3]) << 24);
+        }
+        if (size < sizeof(actionLength) || actionLength > size - sizeof(actionLength))
+        {
+            callback->Failure(-1, "Malformed binary request");
+            return true;
+        }
+
+        const char* actionBegin = reinterpret_cast<const char*>(data + sizeof(actionLength));
+        const std::string action(actionBegin, actionLength);
+        const std::string payload(actionBegin + actionLength, size - sizeof(actionLength) - actionLength);
 
-        if (queryMessage.action.find("test:") != std::string::npos)
+        ActionMetrics& metrics = QueryMetrics::Get().ForAction(action);
+        metrics.decode.Record(Clock::now() - decodeStart);
+
+        IService* service = GetService(action);
+        if (!service)
         {
-            ret = test::TestService::getInstance().onQuery(queryMessage.action, queryMessage.request, resp, errorMsg);
-            response = std::move(resp);
-            error_message = std::move(errorMsg);
-            return ret;
+            callback->Failure(-1, "Unknown action: " + action);
+            metrics.RecordResult(-1);
+            return true;
+        }
+        if (service->isPrivileged(action) && !IsAppFrame(frame))
+        {
+            callback->Failure(-1, "Action not allowed from this origin: " + action);
+            metrics.RecordResult(-1);
+            return true;
         }
 
-        ret = -1;
-        error_message = "Unknown action: " + queryMessage.action;
-        return ret;
+        // Binary queries run on the UI thread and cannot be canceled while they
+        // run, so they are not tracked.
+        CancellationToken token;
+        const auto executeStart = Clock::now();
+        std::atomic<int64_t> encodeTime{ 0 };
+        std::string response;
+        std::string errorMessage;
+        int errorCode = -1;
+        try
+        {
+            ResponseEncodeTime::Scope encodeScope(encodeTime);
+            errorCode = service->onBinaryQuery(action, payload, response, errorMessage, token);
+        }
+        catch (const std::exception& e)
+        {
+            // Decoders throw on malformed payloads from the renderer.
+            response.clear();
+            errorMessage = e.what();
+        }
+        const Clock::duration encode(encodeTime.load(std::memory_order_relaxed));
+        metrics.execute.Record(Clock::now() - executeStart - encode);
+        metrics.encode.Record(encode);
+
+        if (errorCode == 0)
+            callback->Success(response.data(), response.size());
+        else
+            callback->Failure(errorCode, errorMessage);
+        metrics.RecordResult(errorCode);
+
+        return true;
     }
 
-    void MessageHandler::HandleFileDialog(CefRefPtr<CefBrowser> browser, const std::string& request, CefRefPtr<Callback> callback)
+    void MessageHandler::OnQueryCanceled(CefRefPtr<CefBrowser> browser,
+        CefRefPtr<CefFrame> frame,
+        int64_t query_id)
+    {
+        CEF_REQUIRE_UI_THREAD();
+
+        auto it = pending_queries_.find(query_id);
+        if (it == pending_queries_.end())
+            return;
+
+        it->second.cancel();
+        pending_queries_.erase(it);
+    }
+
+    void MessageHandler::FinishQuery(int64_t query_id)
+    {
+        CEF_REQUIRE_UI_THREAD();
+        pending_queries_.erase(query_id);
+    }
+
+    int MessageHandler::OnQueryInternal(IService* service, const std::string& action, const std::string& request, std::string& response, std::string& error_message, const CancellationToken& token)
+    {
+        if (service)
+            return service->onQuery(action, request, response, error_message, token);
+
+        error_message = "Unknown action: " + action;
+        return -1;
+    }
+
+    void MessageHandler::HandleFileDialog(CefRefPtr<CefBrowser> browser, const std::string& request, CefRefPtr<Callback> callback, int64_t query_id, const CancellationToken& token)
     {
         CEF_REQUIRE_UI_THREAD();
         
         CefFileDialogRequest req;
         if (!request.empty())
         {
-            xpack::json::decode(request, req);
+            const xpack::DecodeResult decoded = xpack::json::try_decode(request, req, xpack::JsonArena::Local());
+            if (!decoded)
+            {
+                FinishQuery(query_id);
+                callback->Failure(-1, "Malformed file dialog request: " + decoded.Message());
+                return;
+            }
         }
 
         if (req.title.empty())
@@ -107,28 +513,44 @@ namespace client::message_handler
         // Create file dialog callback
         class FileDialogCallback : public CefRunFileDialogCallback {
         public:
-            FileDialogCallback(CefRefPtr<Callback> query_callback) : query_callback_(query_callback) {}
+            FileDialogCallback(CefRefPtr<Callback> query_callback,
+                               base::WeakPtr<MessageHandler> handler,
+                               int64_t query_id,
+                               const CancellationToken& token)
+                : query_callback_(query_callback), handler_(handler), query_id_(query_id), token_(token) {}
 
             void OnFileDialogDismissed(const std::vector<CefString>& file_paths) override
             {
                 CEF_REQUIRE_UI_THREAD();
 
+                if (handler_)
+                    handler_->FinishQuery(query_id_);
+
+                // The query was canceled while the dialog was open; nobody is
+                // waiting for the result anymore.
+                if (token_.isCancelled())
+                    return;
+
                 CefFileDialogResponse resp;
                 if (!file_paths.empty())
                 {
                     resp.selectedPath = file_paths[0];
                 }
 
-                std::string response = xpack::json::encode(resp);
+                CefString response;
+                EncodeJsonToCefString(resp, response);
                 query_callback_->Success(response);
             }
 
         private:
             CefRefPtr<Callback> query_callback_;
+            base::WeakPtr<MessageHandler> handler_;
+            int64_t query_id_;
+            CancellationToken token_;
             IMPLEMENT_REFCOUNTING(FileDialogCallback);
         };
 
-        CefRefPtr<FileDialogCallback> file_callback = new FileDialogCallback(callback);
+        CefRefPtr<FileDialogCallback> file_callback = new FileDialogCallback(callback, weak_ptr_factory_.GetWeakPtr(), query_id, token);
 
         // Run file dialog
         browser->GetHost()->RunFileDialog(static_cast<cef_file_dialog_mode_t>(req.mode),
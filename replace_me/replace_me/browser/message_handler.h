@@ -5,9 +5,12 @@
 #pragma once
 
 #include <functional>
+#include <map>
 #include <string>
 
+#include "include/base/cef_weak_ptr.h"
 #include "include/wrapper/cef_message_router.h"
+#include "replace_me/services/IService.h"
 
 namespace client::message_handler {
 
@@ -22,14 +25,39 @@ namespace client::message_handler {
             bool persistent,
             CefRefPtr<Callback> callback) override;
 
+        // Binary queries issued through bridge.invokeBinary. The request is
+        // [uint32 little-endian action length][action][payload] and the payload
+        // is handed to IService::onBinaryQuery untouched.
+        bool OnQuery(CefRefPtr<CefBrowser> browser,
+            CefRefPtr<CefFrame> frame,
+            int64_t query_id,
+            CefRefPtr<const CefBinaryBuffer> request,
+            bool persistent,
+            CefRefPtr<Callback> callback) override;
+
+        void OnQueryCanceled(CefRefPtr<CefBrowser> browser,
+            CefRefPtr<CefFrame> frame,
+            int64_t query_id) override;
+
     private:
 
-        int OnQueryInternal(const CefString& request, CefString& response, CefString& error_message);
+        int OnQueryInternal(IService* service, const std::string& action, const std::string& request, std::string& response, std::string& error_message, const CancellationToken& token);
         
         // Handle file dialog request (async)
         void HandleFileDialog(CefRefPtr<CefBrowser> browser,
             const std::string& request,
-            CefRefPtr<Callback> callback);
+            CefRefPtr<Callback> callback,
+            int64_t query_id,
+            const CancellationToken& token);
+
+        // Forget the cancellation token of a query that has completed.
+        void FinishQuery(int64_t query_id);
+
+        // Cancellation tokens of queries that are still running, keyed by query id.
+        std::map<int64_t, CancellationToken> pending_queries_;
+
+        // Must be the last member.
+        base::WeakPtrFactory<MessageHandler> weak_ptr_factory_{this};
 
         DISALLOW_COPY_AND_ASSIGN(MessageHandler);
     };
@@ -0,0 +1,157 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#include "replace_me/browser/query_metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <vector>
+
+#include "xpack.h"
+#include "json.h"
+
+namespace client::message_handler {
+
+    namespace {
+
+        struct LatencySummary {
+            uint64_t count = 0;
+            double meanUs = 0;
+            double p50Us = 0;
+            double p90Us = 0;
+            double p99Us = 0;
+            double maxUs = 0;
+            XPACK(O(count, meanUs, p50Us, p90Us, p99Us, maxUs));
+        };
+
+        struct ActionSummary {
+            std::string action;
+            uint64_t count = 0;
+            uint64_t errors = 0;
+            uint64_t cancelled = 0;
+            double errorRate = 0;
+            LatencySummary decode;
+            LatencySummary execute;
+            LatencySummary encode;
+            XPACK(O(action, count, errors, cancelled, errorRate, decode, execute, encode));
+        };
+
+        struct MetricsSummary {
+            std::vector<ActionSummary> actions;
+            XPACK(O(actions));
+        };
+
+        LatencySummary Summarize(const LatencyHistogram& histogram) {
+            LatencySummary summary;
+            summary.count = histogram.Count();
+            summary.meanUs = histogram.MeanNs() / 1000.0;
+            summary.p50Us = histogram.PercentileNs(50) / 1000.0;
+            summary.p90Us = histogram.PercentileNs(90) / 1000.0;
+            summary.p99Us = histogram.PercentileNs(99) / 1000.0;
+            summary.maxUs = histogram.MaxNs() / 1000.0;
+            return summary;
+        }
+
+    }  // namespace
+
+    void LatencyHistogram::Record(std::chrono::steady_clock::duration duration) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        const uint64_t value = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+
+        buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    double LatencyHistogram::MeanNs() const {
+        const uint64_t count = Count();
+        return count == 0 ? 0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / count;
+    }
+
+    uint64_t LatencyHistogram::PercentileNs(double percentile) const {
+        const uint64_t count = Count();
+        if (count == 0)
+            return 0;
+
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(percentile / 100.0 * count + 0.5));
+        uint64_t seen = 0;
+        for (int i = 0; i < kBucketCount; ++i) {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return std::min(BucketValue(i), MaxNs());
+        }
+        return MaxNs();
+    }
+
+    // static
+    int LatencyHistogram::BucketIndex(uint64_t value) {
+        constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxExponent) - 1;
+        value = std::min(value, kMaxValue);
+        if (value < kSubBuckets)
+            return static_cast<int>(value);
+
+        const int exponent = std::bit_width(value) - 1;
+        const int shift = exponent - kSubBucketBits;
+        const int sub = static_cast<int>((value >> shift) & (kSubBuckets - 1));
+        return (shift + 1) * kSubBuckets + sub;
+    }
+
+    // static
+    uint64_t LatencyHistogram::BucketValue(int index) {
+        if (index < kSubBuckets)
+            return static_cast<uint64_t>(index);
+
+        // Report the highest value that maps to the bucket.
+        const int shift = index / kSubBuckets - 1;
+        const uint64_t sub = static_cast<uint64_t>(index % kSubBuckets);
+        return ((kSubBuckets + sub + 1) << shift) - 1;
+    }
+
+    // static
+    QueryMetrics& QueryMetrics::Get() {
+        static QueryMetrics s_metrics;
+        return s_metrics;
+    }
+
+    ActionMetrics& QueryMetrics::ForAction(std::string_view action) {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto it = actions_.find(action);
+        if (it == actions_.end())
+            it = actions_.emplace(std::string(action), std::make_unique<ActionMetrics>()).first;
+        return *it->second;
+    }
+
+    std::string QueryMetrics::ToJson() const {
+        MetricsSummary summary;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            summary.actions.reserve(actions_.size());
+            for (const auto& [action, metrics] : actions_) {
+                ActionSummary item;
+                item.action = action;
+                item.count = metrics->count.load(std::memory_order_relaxed);
+                item.errors = metrics->errors.load(std::memory_order_relaxed);
+                item.cancelled = metrics->cancelled.load(std::memory_order_relaxed);
+                item.errorRate = item.count == 0 ? 0 : static_cast<double>(item.errors) / item.count;
+                item.decode = Summarize(metrics->decode);
+                item.execute = Summarize(metrics->execute);
+                item.encode = Summarize(metrics->encode);
+                summary.actions.push_back(std::move(item));
+            }
+        }
+        return xpack::json::encode(summary);
+    }
+
+    bool QueryMetrics::DumpToFile(const std::string& path) const {
+        std::ofstream file(path, std::ofstream::binary | std::ofstream::trunc);
+        if (!file)
+            return false;
+        const std::string json = ToJson();
+        return static_cast<bool>(file.write(json.data(), static_cast<std::streamsize>(json.size())));
+    }
+
+}  // namespace client::message_handler
@@ -0,0 +1,107 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_BROWSER_QUERY_METRICS_H_
+#define REPLACE_ME_BROWSER_QUERY_METRICS_H_
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace client::message_handler {
+
+    ///
+    /// Log-linear latency histogram in the spirit of HdrHistogram. Every power
+    /// of two of nanoseconds is split into kSubBuckets linear buckets, which
+    /// bounds the relative error of reported percentiles to 1/kSubBuckets.
+    /// Recording is lock-free and uses relaxed atomics only.
+    ///
+    class LatencyHistogram {
+    public:
+        static constexpr int kSubBucketBits = 3;
+        static constexpr int kSubBuckets = 1 << kSubBucketBits;
+        // Values are clamped to 2^kMaxExponent ns (~18 minutes).
+        static constexpr int kMaxExponent = 40;
+        static constexpr int kBucketCount = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+        void Record(std::chrono::steady_clock::duration duration);
+
+        uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+        uint64_t MaxNs() const { return max_.load(std::memory_order_relaxed); }
+        double MeanNs() const;
+
+        // Returns the value at |percentile| (0-100) in nanoseconds.
+        uint64_t PercentileNs(double percentile) const;
+
+    private:
+        static int BucketIndex(uint64_t value);
+        static uint64_t BucketValue(int index);
+
+        std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+        std::atomic<uint64_t> count_{ 0 };
+        std::atomic<uint64_t> sum_{ 0 };
+        std::atomic<uint64_t> max_{ 0 };
+    };
+
+    ///
+    /// Counters for a single bridge action. A query is split into three phases:
+    /// decode (parsing the envelope), execute (running the service) and encode
+    /// (the service encoding its responses, see ResponseEncodeTime). Execute
+    /// does not include encode.
+    ///
+    struct ActionMetrics {
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<uint64_t> errors{ 0 };
+        // Queries the renderer cancelled before their result was sent; they are
+        // part of |count| but neither successes nor errors.
+        std::atomic<uint64_t> cancelled{ 0 };
+        LatencyHistogram decode;
+        LatencyHistogram execute;
+        LatencyHistogram encode;
+
+        void RecordResult(int error_code) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            if (error_code != 0)
+                errors.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void RecordCancelled() {
+            count.fetch_add(1, std::memory_order_relaxed);
+            cancelled.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    ///
+    /// Per-action query instrumentation for MessageHandler. Exposed to the
+    /// frontend through the built-in "cef:metrics" action and written to the
+    /// file given by --query-metrics-path on shutdown. Thread-safe.
+    ///
+    class QueryMetrics {
+    public:
+        static QueryMetrics& Get();
+
+        // Returns the counters for |action|. The reference stays valid for the
+        // lifetime of the process.
+        ActionMetrics& ForAction(std::string_view action);
+
+        // Returns a JSON summary of all actions with latencies in microseconds.
+        std::string ToJson() const;
+
+        bool DumpToFile(const std::string& path) const;
+
+    private:
+        QueryMetrics() = default;
+
+        mutable std::mutex lock_;
+        std::map<std::string, std::unique_ptr<ActionMetrics>, std::less<>> actions_;
+    };
+
+}  // namespace client::message_handler
+
+#endif  // REPLACE_ME_BROWSER_QUERY_METRICS_H_
@@ -0,0 +1,79 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#include "replace_me/browser/query_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace client::message_handler {
+
+    namespace {
+
+        thread_local bool t_pool_thread = false;
+
+    }  // namespace
+
+    // static
+    QueryPool& QueryPool::Get() {
+        static QueryPool s_pool;
+        return s_pool;
+    }
+
+    QueryPool::QueryPool()
+        : max_threads_(std::clamp<size_t>(std::thread::hardware_concurrency(), kMinThreads, kMaxThreads)) {}
+
+    QueryPool::~QueryPool() {
+        Shutdown();
+    }
+
+    void QueryPool::Post(base::OnceClosure task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_)
+            return;
+
+        queue_.push_back(std::move(task));
+        // Every idle thread takes one task, start a thread for the rest.
+        if (idle_ < queue_.size() && threads_.size() < max_threads_)
+            threads_.emplace_back(&QueryPool::Work, this);
+        else
+            work_.notify_one();
+    }
+
+    // static
+    bool QueryPool::RunsTasksOnCurrentThread() {
+        return t_pool_thread;
+    }
+
+    void QueryPool::Shutdown() {
+        std::vector<std::thread> threads;
+        std::deque<base::OnceClosure> dropped;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            threads.swap(threads_);
+            dropped.swap(queue_);
+        }
+        work_.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    void QueryPool::Work() {
+        t_pool_thread = true;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            ++idle_;
+            work_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            --idle_;
+            if (stop_)
+                return;
+
+            base::OnceClosure task = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            std::move(task).Run();
+            lock.lock();
+        }
+    }
+
+}  // namespace client::message_handler
@@ -0,0 +1,63 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_BROWSER_QUERY_POOL_H_
+#define REPLACE_ME_BROWSER_QUERY_POOL_H_
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "include/base/cef_callback.h"
+
+namespace client::message_handler {
+
+    ///
+    /// Threads that run asynchronous and cancellable service queries. A query
+    /// holds a thread for as long as it runs, so one long file:hash or
+    /// file:list does not hold up the queries posted after it, nor the
+    /// FILE_USER_BLOCKING thread that DistCache and ImageCache load files on.
+    /// Threads are started on demand, up to MaxThreads(); once all of them are
+    /// busy further queries wait in order.
+    ///
+    class QueryPool {
+    public:
+        static constexpr size_t kMinThreads = 4;
+        static constexpr size_t kMaxThreads = 16;
+
+        static QueryPool& Get();
+
+        // Runs |task| on a pool thread. Tasks posted after Shutdown() are
+        // dropped.
+        void Post(base::OnceClosure task);
+
+        // Returns true on a pool thread.
+        static bool RunsTasksOnCurrentThread();
+
+        // Drops the tasks that have not started and waits for the running
+        // ones. Called once the browsers are closed, before CefShutdown().
+        void Shutdown();
+
+        size_t MaxThreads() const { return max_threads_; }
+
+    private:
+        QueryPool();
+        ~QueryPool();
+
+        void Work();
+
+        const size_t max_threads_;
+        std::mutex mutex_;
+        std::condition_variable work_;
+        std::deque<base::OnceClosure> queue_;
+        std::vector<std::thread> threads_;
+        size_t idle_ = 0;
+        bool stop_ = false;
+    };
+
+}  // namespace client::message_handler
+
+#endif  // REPLACE_ME_BROWSER_QUERY_POOL_H_
@@ -0,0 +1,208 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#include "replace_me/browser/request_journal.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "include/base/cef_logging.h"
+#include "include/wrapper/cef_helpers.h"
+
+namespace client::message_handler {
+
+    namespace {
+
+        // File layout: a FileHeader followed by 8-byte aligned records, each a
+        // RecordHeader followed by the key (see KeyOf) and the response. The header
+        // holds the end of the last complete record, which is only advanced once
+        // the record has been written.
+        constexpr uint32_t kFileMagic = 0x4c4e4a52;  // "RJNL"
+        constexpr uint32_t kFileVersion = 2;
+        constexpr uint32_t kRecordMagic = 0x43455252;  // "RREC"
+
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t end;
+        };
+
+        struct RecordHeader {
+            uint32_t magic;
+            uint32_t key_size;
+            uint32_t response_size;
+            int32_t error_code;
+        };
+
+        size_t Align(size_t size) {
+            return (size + 7) & ~size_t(7);
+        }
+
+        FileHeader* HeaderOf(const MappedFile& file) {
+            return reinterpret_cast<FileHeader*>(file.data());
+        }
+
+        // The same requestId may be reused by different actions. Actions never
+        // contain a NUL.
+        std::string KeyOf(const std::string& action, const std::string& request_id) {
+            std::string key;
+            key.reserve(action.size() + 1 + request_id.size());
+            key.append(action).push_back('\0');
+            key.append(request_id);
+            return key;
+        }
+
+    }  // namespace
+
+    // static
+    RequestJournal& RequestJournal::Get() {
+        static RequestJournal s_journal;
+        return s_journal;
+    }
+
+    bool RequestJournal::Open(const std::string& path) {
+        Close();
+        if (!file_.Open(path, MappedFile::Mode::kReadWrite)) {
+            LOG(ERROR) << "Failed to open request journal " << path;
+            return false;
+        }
+
+        const FileHeader* header = HeaderOf(file_);
+        if (file_.size() < sizeof(FileHeader) || header->magic != kFileMagic || header->version != kFileVersion ||
+            header->end < sizeof(FileHeader) || header->end > file_.size()) {
+            return Reset();
+        }
+
+        // Rebuild the index. Stop at the first damaged record; everything after
+        // it is overwritten by the next append. The scan reads the log front to
+        // back, let the OS read ahead.
+        file_.AdviseSequential();
+        end_ = sizeof(FileHeader);
+        while (end_ + sizeof(RecordHeader) <= header->end) {
+            RecordHeader record;
+            std::memcpy(&record, file_.data() + end_, sizeof(record));
+            const size_t payload = size_t(record.key_size) + record.response_size;
+            if (record.magic != kRecordMagic || payload > header->end - end_ - sizeof(record))
+                break;
+
+            // Logs written before failures were left out may still hold some.
+            const char* key = reinterpret_cast<const char*>(file_.data() + end_ + sizeof(record));
+            if (record.error_code == 0) {
+                entries_[std::string(key, record.key_size)] =
+                    Entry{ record.error_code, end_ + sizeof(record) + record.key_size, record.response_size };
+            }
+            end_ += Align(sizeof(record) + payload);
+        }
+        return true;
+    }
+
+    void RequestJournal::Close() {
+        if (file_.IsOpen())
+            file_.Flush();
+        file_.Close();
+        end_ = 0;
+        entries_.clear();
+
+        // The queries that are still running can no longer answer the retries
+        // waiting for them.
+        const auto in_flight = std::move(in_flight_);
+        in_flight_.clear();
+        for (const auto& waiting : in_flight) {
+            for (const auto& callback : waiting.second)
+                callback->Failure(-1, "Request journal closed");
+        }
+    }
+
+    bool RequestJournal::Replay(const std::string& action, const std::string& request_id, CefRefPtr<Callback> callback) {
+        CEF_REQUIRE_UI_THREAD();
+
+        std::string key = KeyOf(action, request_id);
+        auto entry = entries_.find(key);
+        if (entry != entries_.end()) {
+            if (entry->second.error_code == 0)
+                callback->Success(ResponseOf(entry->second));
+            else
+                callback->Failure(entry->second.error_code, ResponseOf(entry->second));
+            return true;
+        }
+
+        // A previous renderer issued the same request and it is still running.
+        auto waiting = in_flight_.find(key);
+        if (waiting != in_flight_.end()) {
+            waiting->second.push_back(callback);
+            return true;
+        }
+
+        in_flight_.emplace(std::move(key), std::vector<CefRefPtr<Callback>>());
+        return false;
+    }
+
+    void RequestJournal::Record(const std::string& action, const std::string& request_id, int error_code, const std::string& response) {
+        CEF_REQUIRE_UI_THREAD();
+
+        // Only results are journaled. A failure may be transient (a locked file,
+        // a full disk), so a retry with the same requestId runs the query again.
+        const std::string key = KeyOf(action, request_id);
+        if (error_code == 0 && !Append(key, error_code, response))
+            LOG(ERROR) << "Failed to journal request " << action << " " << request_id;
+
+        auto waiting = in_flight_.find(key);
+        if (waiting == in_flight_.end())
+            return;
+
+        const std::vector<CefRefPtr<Callback>> callbacks = std::move(waiting->second);
+        in_flight_.erase(waiting);
+        for (const auto& callback : callbacks) {
+            if (error_code == 0)
+                callback->Success(response);
+            else
+                callback->Failure(error_code, response);
+        }
+    }
+
+    bool RequestJournal::Reset() {
+        entries_.clear();
+        if (!file_.Resize(kInitialFileSize))
+            return false;
+
+        FileHeader* header = HeaderOf(file_);
+        header->magic = kFileMagic;
+        header->version = kFileVersion;
+        header->end = sizeof(FileHeader);
+        end_ = sizeof(FileHeader);
+        return true;
+    }
+
+    bool RequestJournal::Append(const std::string& key, int error_code, const std::string& response) {
+        if (!file_.IsOpen())
+            return false;
+
+        const size_t size = Align(sizeof(RecordHeader) + key.size() + response.size());
+        if (sizeof(FileHeader) + size > kMaxFileSize)
+            return false;
+        if (end_ + size > kMaxFileSize && !Reset())
+            return false;
+        if (end_ + size > file_.size() &&
+            !file_.Resize(std::min(kMaxFileSize, std::max(file_.size() * 2, end_ + size)))) {
+            return false;
+        }
+
+        const RecordHeader record{ kRecordMagic, static_cast<uint32_t>(key.size()),
+                                   static_cast<uint32_t>(response.size()), error_code };
+        uint8_t* out = file_.data() + end_;
+        std::memcpy(out, &record, sizeof(record));
+        std::memcpy(out + sizeof(record), key.data(), key.size());
+        std::memcpy(out + sizeof(record) + key.size(), response.data(), response.size());
+
+        entries_[key] = Entry{ error_code, end_ + sizeof(record) + key.size(), response.size() };
+        end_ += size;
+        // Commit the record. The mapping is shared, so it reaches the page cache
+        // right away and survives a crash of the browser process as well.
+        HeaderOf(file_)->end = end_;
+        return true;
+    }
+
+    std::string RequestJournal::ResponseOf(const Entry& entry) const {
+        return std::string(reinterpret_cast<const char*>(file_.data() + entry.offset), entry.size);
+    }
+
+}  // namespace client::message_handler
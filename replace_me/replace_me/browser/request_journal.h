@@ -0,0 +1,79 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_BROWSER_REQUEST_JOURNAL_H_
+#define REPLACE_ME_BROWSER_REQUEST_JOURNAL_H_
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "include/wrapper/cef_message_router.h"
+#include "replace_me/common/mapped_file.h"
+
+namespace client::message_handler {
+
+    ///
+    /// Journal of completed bridge queries keyed by action and the client
+    /// supplied requestId. When the renderer crashes and the page re-issues a
+    /// query it had in flight, the cached result is returned instead of running
+    /// the service again, so side effects happen at most once per requestId.
+    /// Failed queries are not journaled and run again when retried.
+    ///
+    /// Results are appended to a memory-mapped log at --request-journal-path and
+    /// survive browser restarts as well. The log starts over once it reaches
+    /// kMaxFileSize; entries only need to outlive a reload. Must be used on the
+    /// UI thread.
+    ///
+    class RequestJournal {
+    public:
+        using Callback = CefMessageRouterBrowserSide::Callback;
+
+        static constexpr size_t kInitialFileSize = 64 * 1024;
+        static constexpr size_t kMaxFileSize = 64 * 1024 * 1024;
+
+        static RequestJournal& Get();
+
+        bool Open(const std::string& path);
+        void Close();
+        bool IsOpen() const { return file_.IsOpen(); }
+
+        // Called before a journaled query runs. Returns true if the query has
+        // been taken care of: either |callback| was answered from the log, or
+        // the same query is still running and |callback| will be answered by
+        // Record(). Otherwise marks the query as in flight and returns false;
+        // the caller must run it and call Record() however it ends, including
+        // when the service throws.
+        bool Replay(const std::string& action, const std::string& request_id, CefRefPtr<Callback> callback);
+
+        // Appends the result of |action| with |request_id| and answers queries
+        // that were waiting for it. |response| holds the error message if
+        // |error_code| is non-zero; failures only answer the waiting queries and
+        // are not journaled, so the next query with the same requestId runs
+        // again.
+        void Record(const std::string& action, const std::string& request_id, int error_code, const std::string& response);
+
+    private:
+        struct Entry {
+            int error_code = 0;
+            size_t offset = 0;
+            size_t size = 0;
+        };
+
+        RequestJournal() = default;
+
+        bool Reset();
+        bool Append(const std::string& key, int error_code, const std::string& response);
+        std::string ResponseOf(const Entry& entry) const;
+
+        MappedFile file_;
+        size_t end_ = 0;
+        std::unordered_map<std::string, Entry> entries_;
+        std::map<std::string, std::vector<CefRefPtr<Callback>>> in_flight_;
+    };
+
+}  // namespace client::message_handler
+
+#endif  // REPLACE_ME_BROWSER_REQUEST_JOURNAL_H_
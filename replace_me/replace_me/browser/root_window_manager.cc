@@ -373,7 +373,14 @@ CefRefPtr<CefRequestContext> RootWindowManager::CreateRequestContext(
            << file_util::kPathSep << time(nullptr);
         CefString(&settings.cache_path) = ss.str();
       }
+    } else if (request_context_shared_cache_) {
+      // Share the storage of the global context, which defaults to a per-user
+      // cache directory, so the frontend bundle's code cache is used as well.
+      CefString(&settings.cache_path) =
+          CefRequestContext::GetGlobalContext()->GetCachePath();
     }
+    // Otherwise leave the cache path empty: isolated contexts stay in-memory
+    // and do not share the global context's storage.
 
     return CefRequestContext::CreateContext(
         settings, new ClientRequestContextHandler(std::move(callback)));
@@ -0,0 +1,204 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#include "replace_me/browser/startup_trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include "include/base/cef_callback.h"
+#include "include/base/cef_logging.h"
+#include "include/cef_task.h"
+#include "include/cef_trace.h"
+#include "include/wrapper/cef_closure_task.h"
+#include "include/wrapper/cef_helpers.h"
+#include "xpack.h"
+#include "json.h"
+
+namespace client {
+
+    namespace {
+
+        // "v8.compile" and friends are the Compile Script/Module entries of the
+        // DevTools performance panel, the disabled-by-default category adds the
+        // parser's own events.
+        constexpr char kCategories[] = "v8,devtools.timeline,disabled-by-default-v8.compile";
+
+        struct EventSummary {
+            std::string name;
+            uint64_t count = 0;
+            double totalMs = 0;
+            XPACK(O(name, count, totalMs));
+        };
+
+        struct TraceSummary {
+            // From context initialization until the first page stopped loading.
+            double loadMs = 0;
+            // Parsing on the main thread and while streaming in the background.
+            double parseMs = 0;
+            // Compile Script/Module, including parsing on the main thread and
+            // deserializing code from the cache.
+            double compileMs = 0;
+            uint64_t scriptsCompiled = 0;
+            uint64_t scriptsFromCache = 0;
+            uint64_t cacheRejected = 0;
+            uint64_t cacheProduced = 0;
+            std::vector<EventSummary> events;
+            XPACK(O(loadMs, parseMs, compileMs, scriptsCompiled, scriptsFromCache, cacheRejected,
+                    cacheProduced, events));
+        };
+
+        bool StartsWith(const std::string& str, const char* prefix) {
+            return str.rfind(prefix, 0) == 0;
+        }
+
+        bool IsParse(const std::string& name) {
+            return StartsWith(name, "V8.Parse") || name == "v8.parseOnBackground";
+        }
+
+        bool IsCompile(const std::string& name) {
+            return name == "v8.compile" || name == "v8.compileModule";
+        }
+
+        bool IsProduceCache(const std::string& name) {
+            return name == "v8.produceCache" || name == "v8.produceModuleCache";
+        }
+
+        // Adds the complete ("X") events of the V8 categories to |summary|.
+        // Begin/end pairs are not matched; V8 does not emit its compile events
+        // that way.
+        void AddEvents(const rapidjson::Value& events, TraceSummary& summary) {
+            std::map<std::string, EventSummary> by_name;
+            for (const auto& event : events.GetArray()) {
+                if (!event.IsObject() || !event.HasMember("name") || !event["name"].IsString())
+                    continue;
+                const std::string name(event["name"].GetString(), event["name"].GetStringLength());
+                if (!StartsWith(name, "v8.") && !StartsWith(name, "V8."))
+                    continue;
+
+                double ms = 0;
+                if (event.HasMember("ph") && event["ph"].IsString() && event["ph"].GetString()[0] == 'X' &&
+                    event.HasMember("dur") && event["dur"].IsNumber()) {
+                    ms = event["dur"].GetDouble() / 1000;
+                }
+                EventSummary& item = by_name[name];
+                item.name = name;
+                ++item.count;
+                item.totalMs += ms;
+
+                if (IsParse(name))
+                    summary.parseMs += ms;
+                if (IsProduceCache(name))
+                    ++summary.cacheProduced;
+                if (!IsCompile(name))
+                    continue;
+                summary.compileMs += ms;
+                ++summary.scriptsCompiled;
+                if (!event.HasMember("args") || !event["args"].IsObject() ||
+                    !event["args"].HasMember("data") || !event["args"]["data"].IsObject())
+                    continue;
+                const rapidjson::Value& data = event["args"]["data"];
+                if (data.HasMember("consumedCacheSize") && data["consumedCacheSize"].IsNumber() &&
+                    data["consumedCacheSize"].GetDouble() > 0) {
+                    ++summary.scriptsFromCache;
+                }
+                if (data.HasMember("cacheRejected") && data["cacheRejected"].IsBool() &&
+                    data["cacheRejected"].GetBool()) {
+                    ++summary.cacheRejected;
+                }
+            }
+
+            for (auto& [name, item] : by_name)
+                summary.events.push_back(std::move(item));
+            std::sort(summary.events.begin(), summary.events.end(),
+                [](const EventSummary& a, const EventSummary& b) { return a.totalMs > b.totalMs; });
+        }
+
+        class EndTracingCallback : public CefEndTracingCallback {
+        public:
+            explicit EndTracingCallback(double load_ms) : load_ms_(load_ms) {}
+
+            void OnEndTracingComplete(const CefString& tracing_file) override {
+                CefPostTask(TID_FILE_USER_VISIBLE,
+                    base::BindOnce(&StartupTrace::Summarize, tracing_file.ToString(), load_ms_));
+            }
+
+        private:
+            const double load_ms_;
+
+            IMPLEMENT_REFCOUNTING(EndTracingCallback);
+        };
+
+    }  // namespace
+
+    // static
+    StartupTrace& StartupTrace::Get() {
+        static StartupTrace s_trace;
+        return s_trace;
+    }
+
+    void StartupTrace::Begin(const std::string& path) {
+        CEF_REQUIRE_UI_THREAD();
+        if (state_ != State::kIdle)
+            return;
+        if (!CefBeginTracing(kCategories, nullptr)) {
+            LOG(ERROR) << "Failed to start the startup trace";
+            return;
+        }
+        state_ = State::kTracing;
+        path_ = path;
+        begin_ = std::chrono::steady_clock::now();
+    }
+
+    void StartupTrace::OnLoadEnd() {
+        CEF_REQUIRE_UI_THREAD();
+        if (state_ != State::kTracing)
+            return;
+        state_ = State::kEnding;
+        load_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_).count();
+        CefPostDelayedTask(TID_UI, base::BindOnce(&StartupTrace::End, base::Unretained(this)), kSettleDelayMs);
+    }
+
+    void StartupTrace::End() {
+        CEF_REQUIRE_UI_THREAD();
+        if (!CefEndTracing(path_, new EndTracingCallback(load_ms_)))
+            LOG(ERROR) << "Failed to end the startup trace";
+    }
+
+    // static
+    void StartupTrace::Summarize(const std::string& path, double load_ms) {
+        std::ifstream in(path, std::ifstream::binary);
+        const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        rapidjson::Document doc;
+        doc.Parse(text.data(), text.size());
+        if (doc.HasParseError()) {
+            LOG(ERROR) << "Failed to parse the startup trace " << path;
+            return;
+        }
+        // Chromium writes {"traceEvents": [...]}, the bare array is valid too.
+        const rapidjson::Value* events = &doc;
+        if (doc.IsObject() && doc.HasMember("traceEvents"))
+            events = &doc["traceEvents"];
+        if (!events->IsArray()) {
+            LOG(ERROR) << "No trace events in the startup trace " << path;
+            return;
+        }
+
+        TraceSummary summary;
+        summary.loadMs = load_ms;
+        AddEvents(*events, summary);
+
+        LOG(INFO) << "Startup: loaded in " << summary.loadMs << " ms, parse " << summary.parseMs
+                  << " ms, compile " << summary.compileMs << " ms, " << summary.scriptsFromCache << " of "
+                  << summary.scriptsCompiled << " scripts from the code cache";
+
+        const std::string json = xpack::json::encode(summary);
+        std::ofstream out(path + ".summary.json", std::ofstream::binary | std::ofstream::trunc);
+        if (!out.write(json.data(), static_cast<std::streamsize>(json.size())))
+            LOG(ERROR) << "Failed to write the startup trace summary for " << path;
+    }
+
+}  // namespace client
@@ -0,0 +1,56 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_BROWSER_STARTUP_TRACE_H_
+#define REPLACE_ME_BROWSER_STARTUP_TRACE_H_
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace client {
+
+    ///
+    /// Startup benchmark enabled with --startup-trace-path. Records a Chromium
+    /// trace of the V8 categories from context initialization until the first
+    /// page has loaded and settled, writes it to the given path and a summary
+    /// of the script parse and compile time, and of how many scripts were
+    /// compiled from the code cache, to <path>.summary.json.
+    ///
+    /// Comparing the summaries of a launch with an empty cache directory and
+    /// one after --warm-code-cache shows what the code cache saves. Must be
+    /// used on the UI thread.
+    ///
+    class StartupTrace {
+    public:
+        // Time the first page is given after loading to compile the scripts
+        // it loads lazily and to produce its code cache.
+        static constexpr int kSettleDelayMs = 2000;
+
+        static StartupTrace& Get();
+
+        // Starts tracing into |path|. Called once the CEF context is initialized.
+        void Begin(const std::string& path);
+
+        // Called when a main frame finishes loading; the first call schedules
+        // the end of the trace.
+        void OnLoadEnd();
+
+        // Summarizes the trace file at |path|, on a FILE thread.
+        static void Summarize(const std::string& path, double load_ms);
+
+    private:
+        StartupTrace() = default;
+
+        void End();
+
+        enum class State { kIdle, kTracing, kEnding };
+
+        State state_ = State::kIdle;
+        std::string path_;
+        std::chrono::steady_clock::time_point begin_;
+        double load_ms_ = 0;
+    };
+
+}  // namespace client
+
+#endif  // REPLACE_ME_BROWSER_STARTUP_TRACE_H_
@@ -0,0 +1,18 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_COMMON_APP_SCHEME_H_
+#define REPLACE_ME_COMMON_APP_SCHEME_H_
+#pragma once
+
+namespace client {
+
+    // Origin the frontend dist bundle is served from in release builds. The
+    // scheme is registered as standard and secure in every process (see
+    // ClientApp::RegisterCustomSchemes) and answered by the DistCache provider
+    // on the browser side.
+    inline constexpr char kAppScheme[] = "app";
+    inline constexpr char kAppOrigin[] = "app://local/";
+
+}  // namespace client
+
+#endif  // REPLACE_ME_COMMON_APP_SCHEME_H_
@@ -3,6 +3,8 @@
 // can be found in the LICENSE file.
 
 #include "include/cef_command_line.h"
+#include "include/cef_scheme.h"
+#include "replace_me/common/app_scheme.h"
 #include "replace_me/common/client_app.h"
 
 namespace client {
@@ -43,7 +45,14 @@ namespace client {
 
     // static
     void ClientApp::RegisterCustomSchemes(CefRawPtr<CefSchemeRegistrar> registrar) {
-        // No custom schemes registered - using file:// protocol instead
+        // Serves the frontend bundle. Standard and secure so the page gets a
+        // real origin (relative URLs, localStorage, secure-context APIs) without
+        // the file:// access flags. Code cache enabled so V8 keeps the compiled
+        // bundle in the cache directory instead of parsing it on every launch.
+        registrar->AddCustomScheme(kAppScheme,
+            CEF_SCHEME_OPTION_STANDARD | CEF_SCHEME_OPTION_SECURE |
+            CEF_SCHEME_OPTION_CORS_ENABLED | CEF_SCHEME_OPTION_FETCH_ENABLED |
+            CEF_SCHEME_OPTION_CODE_CACHE_ENABLED);
     }
 
     void ClientApp::OnRegisterCustomSchemes(CefRawPtr<CefSchemeRegistrar> registrar) {
@@ -63,5 +63,9 @@ const char kUseChromeStyleWindow[] = "use-chrome-style-window";
 const char kShowOverlayBrowser[] = "show-overlay-browser";
 const char kUseAngle[] = "use-angle";
 const char kOzonePlatform[] = "ozone-platform";
+const char kQueryMetricsPath[] = "query-metrics-path";
+const char kRequestJournalPath[] = "request-journal-path";
+const char kWarmCodeCache[] = "warm-code-cache";
+const char kStartupTracePath[] = "startup-trace-path";
 
 }  // namespace client::switches
@@ -57,6 +57,10 @@ extern const char kUseChromeStyleWindow[];
 extern const char kShowOverlayBrowser[];
 extern const char kUseAngle[];
 extern const char kOzonePlatform[];
+extern const char kQueryMetricsPath[];
+extern const char kRequestJournalPath[];
+extern const char kWarmCodeCache[];
+extern const char kStartupTracePath[];
 
 }  // namespace client::switches
 
@@ -0,0 +1,73 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_COMMON_DIST_PACK_FORMAT_H_
+#define REPLACE_ME_COMMON_DIST_PACK_FORMAT_H_
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Layout of dist.pack, the frontend dist directory packed into one file by
+// tools/dist_pack.cc and served from a memory mapping by DistCache. All
+// integers are little endian.
+//
+//   Header
+//   Entry[entry_count]   sorted bytewise by path, for binary search
+//   paths                Entry::path_offset/path_size, '/' separated,
+//                        relative to dist/ and not NUL terminated
+//   blobs                file contents, each kBlobAlignment aligned
+//
+// Every entry has its file contents as the kIdentity blob and may have a
+// brotli compressed copy, which the browser decodes in process; a variant
+// that is absent has offset 0. Version 1 also had a gzip variant.
+namespace client::dist_pack {
+
+inline constexpr char kMagic[8] = {'R', 'M', 'D', 'I', 'S', 'T', 'P', 'K'};
+inline constexpr uint32_t kVersion = 2;
+inline constexpr size_t kBlobAlignment = 16;
+
+enum Encoding : uint32_t {
+  kIdentity = 0,
+  kBrotli = 1,
+  kEncodingCount = 2,
+};
+
+struct Blob {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t entry_count;
+  uint64_t paths_offset;
+  uint64_t paths_size;
+};
+
+struct Entry {
+  uint64_t path_offset;
+  uint32_t path_size;
+  uint32_t reserved;
+  // HashOf the kIdentity blob, the ETag of the file.
+  uint64_t hash;
+  Blob blobs[kEncodingCount];
+};
+
+static_assert(sizeof(Header) == 32, "dist.pack header layout");
+static_assert(sizeof(Entry) == 56, "dist.pack entry layout");
+
+// 64-bit FNV-1a, the same content hash FileService reports.
+inline uint64_t HashOf(const void* data, size_t size) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+}  // namespace client::dist_pack
+
+#endif  // REPLACE_ME_COMMON_DIST_PACK_FORMAT_H_
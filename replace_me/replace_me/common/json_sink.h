@@ -0,0 +1,56 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_COMMON_JSON_SINK_H_
+#define REPLACE_ME_COMMON_JSON_SINK_H_
+#pragma once
+
+#include <stdexcept>
+
+#include "include/cef_stream.h"
+#include "include/cef_values.h"
+#include "json.h"
+
+namespace client {
+
+// Helpers that encode a value to JSON in the calling thread's reusable
+// xpack::JsonBuffer and hand the text to CEF with a single copy: the UTF-8
+// to CefString conversion, or the copy into a CefBinaryValue. Use them instead
+// of xpack::json::encode() when the result only goes to CEF.
+
+// |result| is an out parameter because copying a CefString copies its data.
+template <class T>
+void EncodeJsonToCefString(const T& value, CefString& result) {
+  xpack::JsonBuffer& buffer = xpack::JsonBuffer::Local();
+  xpack::json::encode(value, buffer);
+  result.clear();
+  cef_string_from_utf8(buffer.Data(), buffer.Size(),
+                       result.GetWritableStruct());
+}
+
+template <class T>
+CefRefPtr<CefBinaryValue> EncodeJsonToBinaryValue(const T& value) {
+  xpack::JsonBuffer& buffer = xpack::JsonBuffer::Local();
+  xpack::json::encode(value, buffer);
+  return CefBinaryValue::Create(buffer.Data(), buffer.Size());
+}
+
+// Streams xpack::json::encode(value, sink) output into a CefWriteHandler, such
+// as BytesWriteHandler, one chunk at a time.
+class CefWriteHandlerJsonSink : public xpack::JsonSink {
+ public:
+  explicit CefWriteHandlerJsonSink(CefRefPtr<CefWriteHandler> handler)
+      : handler_(handler) {}
+
+  void Write(const char* data, size_t size) override {
+    if (handler_->Write(data, 1, size) != size) {
+      throw std::runtime_error("Write json to CefWriteHandler fail.");
+    }
+  }
+
+ private:
+  CefRefPtr<CefWriteHandler> handler_;
+};
+
+}  // namespace client
+
+#endif  // REPLACE_ME_COMMON_JSON_SINK_H_
@@ -0,0 +1,64 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#ifndef REPLACE_ME_COMMON_MAPPED_FILE_H_
+#define REPLACE_ME_COMMON_MAPPED_FILE_H_
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "include/base/cef_build.h"
+
+namespace client {
+
+// Memory mapping of a whole file.
+//
+// kReadOnly maps the file privately and copy-on-write, so callers may modify
+// the bytes in place (e.g. for in situ parsing) without touching the file.
+// kReadWrite maps the file shared, creating it if needed; Resize() grows or
+// shrinks the file and remaps it, which invalidates previous data() pointers.
+class MappedFile {
+ public:
+  enum class Mode { kReadOnly, kReadWrite };
+
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::string& path, Mode mode);
+  void Close();
+
+  // Only valid for kReadWrite mappings.
+  bool Resize(size_t size);
+
+  // Flushes dirty pages of a kReadWrite mapping to disk.
+  bool Flush();
+
+  // Hints the OS that the mapping will be read front to back.
+  void AdviseSequential();
+
+  bool IsOpen() const;
+  uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  bool Map();
+  void Unmap();
+
+  Mode mode_ = Mode::kReadOnly;
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#if defined(OS_WIN)
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+}  // namespace client
+
+#endif  // REPLACE_ME_COMMON_MAPPED_FILE_H_
@@ -0,0 +1,105 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#include "replace_me/common/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace client {
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+bool MappedFile::Open(const std::string& path, Mode mode) {
+  Close();
+  mode_ = mode;
+
+  const int flags = mode == Mode::kReadOnly ? O_RDONLY : (O_RDWR | O_CREAT);
+  fd_ = open(path.c_str(), flags | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    Close();
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+
+  if (!Map()) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::Close() {
+  Unmap();
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+}
+
+bool MappedFile::Resize(size_t size) {
+  if (fd_ < 0 || mode_ != Mode::kReadWrite) {
+    return false;
+  }
+
+  Unmap();
+  if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+    Map();
+    return false;
+  }
+  size_ = size;
+  return Map();
+}
+
+bool MappedFile::Flush() {
+  if (data_ == nullptr || mode_ != Mode::kReadWrite) {
+    return false;
+  }
+  return msync(data_, size_, MS_SYNC) == 0;
+}
+
+void MappedFile::AdviseSequential() {
+  if (data_ != nullptr) {
+    // Advice values are not flags; each one needs a call of its own.
+    madvise(data_, size_, MADV_SEQUENTIAL);
+    madvise(data_, size_, MADV_WILLNEED);
+  }
+}
+
+bool MappedFile::IsOpen() const {
+  return fd_ >= 0;
+}
+
+bool MappedFile::Map() {
+  // mmap() rejects empty mappings; an empty file simply has no data.
+  if (size_ == 0) {
+    return true;
+  }
+
+  // Read-only mappings are private, so writing to them is allowed.
+  const int flags = mode_ == Mode::kReadOnly ? MAP_PRIVATE : MAP_SHARED;
+  void* data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, flags, fd_, 0);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  data_ = static_cast<uint8_t*>(data);
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+  }
+}
+
+}  // namespace client
@@ -0,0 +1,132 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+#include "replace_me/common/mapped_file.h"
+
+#include <windows.h>
+
+#include <string>
+
+namespace client {
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+bool MappedFile::Open(const std::string& path, Mode mode) {
+  Close();
+  mode_ = mode;
+
+  const int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  std::wstring wpath(length > 0 ? length - 1 : 0, L'\0');
+  if (length > 0) {
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wpath.data(), length);
+  }
+
+  const DWORD access =
+      mode == Mode::kReadOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
+  const DWORD disposition = mode == Mode::kReadOnly ? OPEN_EXISTING : OPEN_ALWAYS;
+  HANDLE file = CreateFileW(wpath.c_str(), access, FILE_SHARE_READ, nullptr,
+                            disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  file_ = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    Close();
+    return false;
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+
+  if (!Map()) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::Close() {
+  Unmap();
+  if (file_) {
+    CloseHandle(static_cast<HANDLE>(file_));
+    file_ = nullptr;
+  }
+  size_ = 0;
+}
+
+bool MappedFile::Resize(size_t size) {
+  if (!file_ || mode_ != Mode::kReadWrite) {
+    return false;
+  }
+
+  Unmap();
+  LARGE_INTEGER offset;
+  offset.QuadPart = static_cast<LONGLONG>(size);
+  if (!SetFilePointerEx(static_cast<HANDLE>(file_), offset, nullptr,
+                        FILE_BEGIN) ||
+      !SetEndOfFile(static_cast<HANDLE>(file_))) {
+    Map();
+    return false;
+  }
+  size_ = size;
+  return Map();
+}
+
+bool MappedFile::Flush() {
+  if (!data_ || mode_ != Mode::kReadWrite) {
+    return false;
+  }
+  return FlushViewOfFile(data_, size_) &&
+         FlushFileBuffers(static_cast<HANDLE>(file_));
+}
+
+void MappedFile::AdviseSequential() {
+  if (data_) {
+    WIN32_MEMORY_RANGE_ENTRY range = {data_, size_};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+  }
+}
+
+bool MappedFile::IsOpen() const {
+  return file_ != nullptr;
+}
+
+bool MappedFile::Map() {
+  // Windows cannot map empty files; an empty file simply has no data.
+  if (size_ == 0) {
+    return true;
+  }
+
+  const DWORD protect =
+      mode_ == Mode::kReadOnly ? PAGE_WRITECOPY : PAGE_READWRITE;
+  HANDLE mapping = CreateFileMappingW(static_cast<HANDLE>(file_), nullptr,
+                                      protect, 0, 0, nullptr);
+  if (!mapping) {
+    return false;
+  }
+
+  const DWORD access =
+      mode_ == Mode::kReadOnly ? FILE_MAP_COPY : FILE_MAP_ALL_ACCESS;
+  void* data = MapViewOfFile(mapping, access, 0, 0, size_);
+  if (!data) {
+    CloseHandle(mapping);
+    return false;
+  }
+  mapping_ = mapping;
+  data_ = static_cast<uint8_t*>(data);
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+  }
+  if (mapping_) {
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    mapping_ = nullptr;
+  }
+}
+
+}  // namespace client
@@ -1,9 +1,155 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <string>
+#include "xpack.h"
+#include "json.h"
+
+// Cancellation flag shared between MessageHandler and the service handling a
+// query. Copies refer to the same flag, so cancelling any copy is observed by
+// all of them. Services doing long-running work should poll isCancelled().
+class CancellationToken
+{
+public:
+    CancellationToken() : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const { cancelled_->store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled_->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Time spent encoding the responses of the query running on the current
+// thread. MessageHandler reports it as the "encode" phase of the query instead
+// of as part of "execute"; services encode inside a Timer, usually through
+// encodeResponse().
+class ResponseEncodeTime
+{
+public:
+    // Adds the time encoding takes to the scope of the current query.
+    class Timer
+    {
+    public:
+        Timer() : start_(std::chrono::steady_clock::now()) {}
+        ~Timer()
+        {
+            if (std::atomic<int64_t>* total = current())
+                total->fetch_add((std::chrono::steady_clock::now() - start_).count(), std::memory_order_relaxed);
+        }
+
+    private:
+        const std::chrono::steady_clock::time_point start_;
+    };
+
+    // Collects the encode time of the current thread into |total|, in
+    // steady_clock ticks, while it is alive.
+    class Scope
+    {
+    public:
+        explicit Scope(std::atomic<int64_t>& total) : previous_(current()) { current() = &total; }
+        ~Scope() { current() = previous_; }
+
+    private:
+        std::atomic<int64_t>* const previous_;
+    };
+
+private:
+    static std::atomic<int64_t>*& current()
+    {
+        thread_local std::atomic<int64_t>* s_total = nullptr;
+        return s_total;
+    }
+};
+
+// Encodes a service response as json, timed as the query's encode phase.
+template <class T>
+std::string encodeResponse(const T& resp)
+{
+    ResponseEncodeTime::Timer timer;
+    return xpack::json::encode(resp);
+}
+
+// Delivers the result of an asynchronous query. Methods may be called from any
+// thread; MessageHandler forwards them to the UI thread. Exactly one of
+// success() or failure() must be called to complete the query, unless the
+// query has been cancelled.
+class QueryResponder
+{
+public:
+    virtual ~QueryResponder() = default;
+
+    // True if the query is persistent and therefore accepts partial results.
+    virtual bool streaming() const = 0;
+
+    // Sends a partial result. Ignored unless streaming() is true.
+    virtual void chunk(const std::string& response) = 0;
+
+    virtual void success(const std::string& response) = 0;
+    virtual void failure(int code, const std::string& message) = 0;
+
+    // Emits |data| to |eventName| listeners through event::EventNotifier.
+    virtual void progress(const std::string& eventName, const std::string& data) = 0;
+};
 
 class IService
 {
 public:
     virtual int onQuery(const std::string& action, const std::string& request, std::string& response, std::string& message) = 0;
-};
\ No newline at end of file
+
+    // Cancellable variant called by MessageHandler. Override it when the work
+    // can be interrupted, and return true from isCancellable() for the action;
+    // by default the token is ignored.
+    virtual int onQuery(const std::string& action, const std::string& request, std::string& response, std::string& message, const CancellationToken& token)
+    {
+        (void)token;
+        return onQuery(action, request, response, message);
+    }
+
+    // Binary variant used by bridge.invokeBinary. |request| and |response| hold
+    // raw bytes (BSON when built with OPTION_USE_BSON).
+    virtual int onBinaryQuery(const std::string& action, const std::string& request, std::string& response, std::string& message, const CancellationToken& token)
+    {
+        (void)request;
+        (void)response;
+        (void)token;
+        message = "Binary query not supported: " + action;
+        return -1;
+    }
+
+    // Returns true if |action| may only be queried by the frontend's own pages,
+    // i.e. frames on kAppOrigin. Queries from any other frame fail.
+    virtual bool isPrivileged(const std::string& action) const
+    {
+        (void)action;
+        return false;
+    }
+
+    // Returns true if onQuery() polls the token for |action|. Such queries run
+    // off the UI thread like asynchronous ones, so that cancelling them in JS
+    // stops the work while it runs. The same threading rules apply.
+    virtual bool isCancellable(const std::string& action) const
+    {
+        (void)action;
+        return false;
+    }
+
+    // Returns true if |action| must run through onQueryAsync. Asynchronous
+    // queries are executed on a pool of threads, several at once, so they may
+    // block on I/O but must not touch UI-thread state directly and must guard
+    // state they share.
+    virtual bool isAsync(const std::string& action) const
+    {
+        (void)action;
+        return false;
+    }
+
+    virtual void onQueryAsync(const std::string& action, const std::string& request, std::shared_ptr<QueryResponder> responder, const CancellationToken& token)
+    {
+        (void)request;
+        (void)token;
+        responder->failure(-1, "Asynchronous query not supported: " + action);
+    }
+};
@@ -0,0 +1,434 @@
+#pragma once
+#include "IService.h"
+#include "request_schemas.h"
+#include "xpack.h"
+#include "json.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace file
+{
+    struct FileEntry
+    {
+        std::string name;
+        std::string path;
+        bool isDirectory = false;
+        uint64_t size = 0;
+        XPACK(O(name, path, isDirectory, size));
+    };
+
+    struct FileListReq
+    {
+        std::string path;
+        bool recursive = false;
+        int chunkSize = 0;
+        XPACK(O(path, recursive, chunkSize));
+    };
+
+    struct FileListResp
+    {
+        std::vector<FileEntry> entries;
+        bool done = false;
+        XPACK(O(entries, done));
+    };
+
+    struct FileListProgress
+    {
+        std::string path;
+        uint64_t count = 0;
+        XPACK(O(path, count));
+    };
+
+    struct FileReadReq
+    {
+        std::string path;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        int chunkSize = 0;
+        XPACK(O(path, offset, length, chunkSize));
+    };
+
+    struct FileReadResp
+    {
+        // Base64 of the bytes read. Query responses reach JS as UTF-16 strings,
+        // which cannot carry bytes that are not valid UTF-8.
+        std::string data;
+        uint64_t offset = 0;
+        bool done = false;
+        XPACK(O(data, offset, done));
+    };
+
+    struct FileWriteReq
+    {
+        std::string path;
+        std::string data;
+        bool append = false;
+        XPACK(O(path, data, append));
+    };
+
+    struct FileWriteResp
+    {
+        uint64_t bytesWritten = 0;
+        XPACK(O(bytesWritten));
+    };
+
+    struct FileHashReq
+    {
+        std::string path;
+        XPACK(O(path));
+    };
+
+    struct FileHashResp
+    {
+        std::string hash;
+        uint64_t size = 0;
+        XPACK(O(hash, size));
+    };
+
+    struct FileHashProgress
+    {
+        std::string path;
+        uint64_t bytesRead = 0;
+        uint64_t totalBytes = 0;
+        XPACK(O(path, bytesRead, totalBytes));
+    };
+
+    inline std::filesystem::path toPath(const std::string& utf8)
+    {
+        return std::filesystem::path(std::u8string(utf8.begin(), utf8.end()));
+    }
+
+    inline std::string toUtf8(const std::filesystem::path& path)
+    {
+        const std::u8string str = path.u8string();
+        return std::string(str.begin(), str.end());
+    }
+
+    inline std::string toBase64(const char* data, size_t size)
+    {
+        static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        out.reserve((size + 2) / 3 * 4);
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        size_t i = 0;
+        for (; i + 3 <= size; i += 3)
+        {
+            const uint32_t v = (uint32_t(p[i]) << 16) | (uint32_t(p[i + 1]) << 8) | p[i + 2];
+            out += kAlphabet[v >> 18];
+            out += kAlphabet[(v >> 12) & 63];
+            out += kAlphabet[(v >> 6) & 63];
+            out += kAlphabet[v & 63];
+        }
+        if (i < size)
+        {
+            const uint32_t v = (uint32_t(p[i]) << 16) | (i + 1 < size ? uint32_t(p[i + 1]) << 8 : 0);
+            out += kAlphabet[v >> 18];
+            out += kAlphabet[(v >> 12) & 63];
+            out += i + 1 < size ? kAlphabet[(v >> 6) & 63] : '=';
+            out += '=';
+        }
+        return out;
+    }
+
+    // Native file I/O. Every action is asynchronous: MessageHandler runs it on
+    // its query pool and the UI thread only sees the results.
+    // Persistent queries receive results in chunks ({..., done: false} until the
+    // last one); large operations also report progress through EventNotifier.
+    class FileService : public IService
+    {
+    public:
+        static constexpr int kDefaultListChunk = 1000;
+        static constexpr int kDefaultReadChunk = 1 << 20;
+
+        static FileService& getInstance()
+        {
+            static FileService s_instance;
+            return s_instance;
+        }
+
+        int onQuery(const std::string& action, const std::string& request, std::string& response, std::string& message) override
+        {
+            (void)request;
+            (void)response;
+            message = "Action must be queried asynchronously: " + action;
+            return -1;
+        }
+
+        bool isAsync(const std::string& action) const override
+        {
+            return action == "file:list" || action == "file:read" || action == "file:write" || action == "file:hash";
+        }
+
+        // Any path may be read or written, keep pages from other origins out.
+        bool isPrivileged(const std::string& action) const override
+        {
+            return isAsync(action);
+        }
+
+        void onQueryAsync(const std::string& action, const std::string& request, std::shared_ptr<QueryResponder> responder, const CancellationToken& token) override
+        {
+            if (action == "file:list")
+            {
+                FileListReq req;
+                std::string message;
+                if (!schemas_.decode(action, request, req, message))
+                {
+                    responder->failure(-1, message);
+                    return;
+                }
+                list(req, *responder, token);
+            }
+            else if (action == "file:read")
+            {
+                FileReadReq req;
+                std::string message;
+                if (!schemas_.decode(action, request, req, message))
+                {
+                    responder->failure(-1, message);
+                    return;
+                }
+                read(req, *responder, token);
+            }
+            else if (action == "file:write")
+            {
+                FileWriteReq req;
+                std::string message;
+                if (!schemas_.decode(action, request, req, message))
+                {
+                    responder->failure(-1, message);
+                    return;
+                }
+                write(req, *responder);
+            }
+            else if (action == "file:hash")
+            {
+                FileHashReq req;
+                std::string message;
+                if (!schemas_.decode(action, request, req, message))
+                {
+                    responder->failure(-1, message);
+                    return;
+                }
+                hash(req, *responder, token);
+            }
+            else
+            {
+                IService::onQueryAsync(action, request, responder, token);
+            }
+        }
+
+    private:
+        FileService()
+        {
+            schemas_.add("file:list", R"({
+                "type": "object",
+                "properties": {
+                    "path": { "type": "string", "minLength": 1 },
+                    "recursive": { "type": "boolean" },
+                    "chunkSize": { "type": "integer", "minimum": 0 }
+                },
+                "required": ["path"]
+            })");
+            schemas_.add("file:read", R"({
+                "type": "object",
+                "properties": {
+                    "path": { "type": "string", "minLength": 1 },
+                    "offset": { "type": "integer", "minimum": 0 },
+                    "length": { "type": "integer", "minimum": 0 },
+                    "chunkSize": { "type": "integer", "minimum": 0 }
+                },
+                "required": ["path"]
+            })");
+            schemas_.add("file:write", R"({
+                "type": "object",
+                "properties": {
+                    "path": { "type": "string", "minLength": 1 },
+                    "data": { "type": "string" },
+                    "append": { "type": "boolean" }
+                },
+                "required": ["path", "data"]
+            })");
+            schemas_.add("file:hash", R"({
+                "type": "object",
+                "properties": { "path": { "type": "string", "minLength": 1 } },
+                "required": ["path"]
+            })");
+        }
+
+        void list(const FileListReq& req, QueryResponder& responder, const CancellationToken& token)
+        {
+            namespace fs = std::filesystem;
+
+            const size_t chunkSize = req.chunkSize > 0 ? static_cast<size_t>(req.chunkSize) : kDefaultListChunk;
+            FileListResp resp;
+            FileListProgress progress{ req.path, 0 };
+
+            auto addEntry = [&](const fs::directory_entry& entry)
+            {
+                std::error_code ec;
+                FileEntry item;
+                item.name = toUtf8(entry.path().filename());
+                item.path = toUtf8(entry.path());
+                item.isDirectory = entry.is_directory(ec);
+                item.size = item.isDirectory ? 0 : static_cast<uint64_t>(entry.file_size(ec));
+                resp.entries.push_back(std::move(item));
+                ++progress.count;
+
+                if (progress.count % chunkSize == 0)
+                {
+                    if (responder.streaming())
+                    {
+                        responder.chunk(encodeResponse(resp));
+                        resp.entries.clear();
+                    }
+                    responder.progress("file:listProgress", encodeResponse(progress));
+                }
+            };
+
+            std::error_code ec;
+            const auto options = fs::directory_options::skip_permission_denied;
+            if (req.recursive)
+            {
+                for (fs::recursive_directory_iterator it(toPath(req.path), options, ec), end; !ec && it != end; it.increment(ec))
+                {
+                    if (token.isCancelled())
+                        return;
+                    addEntry(*it);
+                }
+            }
+            else
+            {
+                for (fs::directory_iterator it(toPath(req.path), options, ec), end; !ec && it != end; it.increment(ec))
+                {
+                    if (token.isCancelled())
+                        return;
+                    addEntry(*it);
+                }
+            }
+
+            if (ec)
+            {
+                responder.failure(-1, "List directory [" + req.path + "] fail. " + ec.message());
+                return;
+            }
+
+            resp.done = true;
+            responder.success(encodeResponse(resp));
+        }
+
+        void read(const FileReadReq& req, QueryResponder& responder, const CancellationToken& token)
+        {
+            std::ifstream fs(toPath(req.path), std::ifstream::binary);
+            if (!fs)
+            {
+                responder.failure(-1, "Open file [" + req.path + "] fail.");
+                return;
+            }
+
+            fs.seekg(0, std::ios::end);
+            const uint64_t fileSize = static_cast<uint64_t>(fs.tellg());
+            const uint64_t begin = std::min(req.offset, fileSize);
+            // begin + length may wrap around for a huge length
+            const uint64_t end = req.length > 0 ? begin + std::min(req.length, fileSize - begin) : fileSize;
+            fs.seekg(static_cast<std::streamoff>(begin));
+
+            // Without streaming the whole range goes out in a single response.
+            const uint64_t chunkSize = responder.streaming()
+                ? (req.chunkSize > 0 ? static_cast<uint64_t>(req.chunkSize) : kDefaultReadChunk)
+                : end - begin;
+
+            FileReadResp resp;
+            resp.offset = begin;
+            std::string buffer;
+            while (true)
+            {
+                if (token.isCancelled())
+                    return;
+
+                // Every chunk is encoded on its own, so chunks decode separately.
+                const uint64_t size = std::min(chunkSize, end - resp.offset);
+                buffer.resize(static_cast<size_t>(size));
+                if (size > 0 && !fs.read(buffer.data(), static_cast<std::streamsize>(size)))
+                {
+                    responder.failure(-1, "Read file [" + req.path + "] fail.");
+                    return;
+                }
+                resp.data = toBase64(buffer.data(), buffer.size());
+
+                resp.done = resp.offset + size >= end;
+                if (resp.done)
+                {
+                    responder.success(encodeResponse(resp));
+                    return;
+                }
+                responder.chunk(encodeResponse(resp));
+                resp.offset += size;
+            }
+        }
+
+        void write(const FileWriteReq& req, QueryResponder& responder)
+        {
+            const auto mode = std::ofstream::binary | (req.append ? std::ofstream::app : std::ofstream::trunc);
+            std::ofstream fs(toPath(req.path), mode);
+            if (!fs || !fs.write(req.data.data(), static_cast<std::streamsize>(req.data.size())))
+            {
+                responder.failure(-1, "Write file [" + req.path + "] fail.");
+                return;
+            }
+
+            FileWriteResp resp{ req.data.size() };
+            responder.success(encodeResponse(resp));
+        }
+
+        // 64-bit FNV-1a over the file contents, reported as 16 hex digits.
+        void hash(const FileHashReq& req, QueryResponder& responder, const CancellationToken& token)
+        {
+            std::ifstream fs(toPath(req.path), std::ifstream::binary);
+            if (!fs)
+            {
+                responder.failure(-1, "Open file [" + req.path + "] fail.");
+                return;
+            }
+
+            std::error_code ec;
+            FileHashProgress progress{ req.path, 0, static_cast<uint64_t>(std::filesystem::file_size(toPath(req.path), ec)) };
+
+            uint64_t h = 14695981039346656037ULL;
+            std::vector<char> buffer(kDefaultReadChunk);
+            while (fs)
+            {
+                if (token.isCancelled())
+                    return;
+
+                fs.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                const size_t count = static_cast<size_t>(fs.gcount());
+                for (size_t i = 0; i < count; ++i)
+                {
+                    h ^= static_cast<unsigned char>(buffer[i]);
+                    h *= 1099511628211ULL;
+                }
+
+                progress.bytesRead += count;
+                responder.progress("file:hashProgress", encodeResponse(progress));
+            }
+
+            // The loop also ends on a read error; only a complete read is hashed.
+            if (!fs.eof())
+            {
+                responder.failure(-1, "Read file [" + req.path + "] fail.");
+                return;
+            }
+
+            char hex[17];
+            std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(h));
+            FileHashResp resp{ hex, progress.bytesRead };
+            responder.success(encodeResponse(resp));
+        }
+
+        RequestSchemas schemas_;
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "xpack.h"
+#include "json.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// JSON schemas of service requests, keyed by action. A schema is compiled into
+// an xpack::JsonSchema when it is added, normally in the service constructor,
+// and only read afterwards, so services may decode from any thread.
+class RequestSchemas
+{
+public:
+    void add(const std::string& action, const char* schema)
+    {
+        schemas_[action] = std::make_unique<xpack::JsonSchema>(schema);
+    }
+
+    const xpack::JsonSchema* find(const std::string& action) const
+    {
+        auto it = schemas_.find(action);
+        return it != schemas_.end() ? it->second.get() : nullptr;
+    }
+
+    // Decodes |request| into |req| without throwing. With a schema for
+    // |action| the request is validated while it is parsed, so a malformed one
+    // is rejected before |req| is touched. On failure returns false with the
+    // reason in |message|.
+    template <class T>
+    bool decode(const std::string& action, const std::string& request, T& req, std::string& message) const
+    {
+        const xpack::JsonSchema* schema = find(action);
+        const xpack::DecodeResult result = schema
+            ? xpack::json::try_decode(request, req, *schema, xpack::JsonArena::Local())
+            : xpack::json::try_decode(request, req, xpack::JsonArena::Local());
+        if (!result)
+        {
+            message = "Invalid request for " + action + ". " + result.Message();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<xpack::JsonSchema>> schemas_;
+};
@@ -1,9 +1,15 @@
 #pragma once
 #include "iservice.h"
+#include "request_schemas.h"
 #include "xpack.h"
 #include "json.h"
+#ifdef REPLACE_ME_USE_BSON
+#include "bson.h"
+#endif
 #include "replace_me/common/event_notify.h"
+#include <chrono>
 #include <iostream>
+#include <mutex>
 
 namespace test
 {
@@ -33,9 +39,25 @@ namespace test
         XPACK(O(eventName, data));
     };
 
+    struct TestBusyReq
+    {
+        int ms = 0;
+        XPACK(O(ms));
+    };
+
+    // Outcome of the last test:busy query, returned by test:busyStatus.
+    struct TestBusyStatus
+    {
+        bool cancelled = false;
+        uint64_t iterations = 0;
+        double elapsedMs = 0;
+        XPACK(O(cancelled, iterations, elapsedMs));
+    };
+
 	class TestService : public IService
 	{
 	public:
+		using IService::onQuery;
 
 		static TestService& getInstance()
 		{
@@ -48,26 +70,119 @@ namespace test
             if (action == "test:invoke")
             {
                 TestInvokeReq req;
-                xpack::json::decode(request, req);
+                if (!schemas_.decode(action, request, req, message))
+                    return -1;
                 TestInvokeResp resp{ "success" };
-                response = xpack::json::encode(resp);
+                response = encodeResponse(resp);
                 return 0;
             }
             else if (action == "test:invokeError")
             {
                 TestInvokeErrorReq req;
-                xpack::json::decode(request, req);
+                if (!schemas_.decode(action, request, req, message))
+                    return -1;
                 message = req.info;
                 return req.error;
             }
             else if (action == "test:emitEvent")
             {
                 TestEmitEventReq req;
-                xpack::json::decode(request, req);
+                if (!schemas_.decode(action, request, req, message))
+                    return -1;
                 event::EventNotifier::getInstance().emit(req.eventName, req.data);
             }
+            else if (action == "test:busyStatus")
+            {
+                std::lock_guard<std::mutex> guard(busyLock_);
+                response = encodeResponse(busyStatus_);
+            }
+
+            return 0;
+		}
+
+		// test:busy keeps a CPU busy for |ms| milliseconds, polling the token.
+		// Cancelling the query in JS ends it early, which test:busyStatus then
+		// reports.
+		int onQuery(const std::string& action, const std::string& request, std::string& response, std::string& message, const CancellationToken& token) override
+		{
+            if (action != "test:busy")
+                return onQuery(action, request, response, message);
+
+            TestBusyReq req;
+            if (!schemas_.decode(action, request, req, message))
+                return -1;
+
+            using Clock = std::chrono::steady_clock;
+            const auto start = Clock::now();
+            const auto deadline = start + std::chrono::milliseconds(req.ms);
+            TestBusyStatus status;
+            volatile uint64_t sink = 0;
+            while (Clock::now() < deadline)
+            {
+                if (token.isCancelled())
+                {
+                    status.cancelled = true;
+                    break;
+                }
+                for (int i = 0; i < 10000; ++i)
+                    sink = sink * 6364136223846793005ULL + 1442695040888963407ULL;
+                ++status.iterations;
+            }
+            status.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
 
+            std::lock_guard<std::mutex> guard(busyLock_);
+            busyStatus_ = status;
+            response = encodeResponse(status);
             return 0;
 		}
+
+		bool isCancellable(const std::string& action) const override
+		{
+            return action == "test:busy";
+		}
+
+		int onBinaryQuery(const std::string& action, const std::string& request, std::string& response, std::string& message, const CancellationToken& token) override
+		{
+#ifdef REPLACE_ME_USE_BSON
+            if (action == "test:invoke")
+            {
+                TestInvokeReq req;
+                xpack::bson::decode(request, req);
+                TestInvokeResp resp{ "success" };
+                ResponseEncodeTime::Timer timer;
+                response = xpack::bson::encode(resp);
+                return 0;
+            }
+#endif
+            return IService::onBinaryQuery(action, request, response, message, token);
+		}
+
+	private:
+		TestService()
+		{
+            schemas_.add("test:invoke", R"({
+                "type": "object",
+                "properties": { "info": { "type": "string" } }
+            })");
+            schemas_.add("test:invokeError", R"({
+                "type": "object",
+                "properties": { "info": { "type": "string" }, "error": { "type": "integer" } },
+                "required": ["error"]
+            })");
+            schemas_.add("test:busy", R"({
+                "type": "object",
+                "properties": { "ms": { "type": "integer", "minimum": 0 } },
+                "required": ["ms"]
+            })");
+            schemas_.add("test:emitEvent", R"({
+                "type": "object",
+                "properties": { "eventName": { "type": "string", "minLength": 1 }, "data": { "type": "string" } },
+                "required": ["eventName"]
+            })");
+		}
+
+		RequestSchemas schemas_;
+		std::mutex busyLock_;
+		TestBusyStatus busyStatus_;
 	};
 }
\ No newline at end of file
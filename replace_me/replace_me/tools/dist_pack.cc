@@ -0,0 +1,283 @@
+// Copyright (c) 2024 replace_me Authors. All rights reserved.
+
+// Packs the frontend dist directory into a single dist.pack archive, see
+// common/dist_pack_format.h. Run by the build after the application target:
+//
+//   dist_pack <dist directory> <output file>
+//
+// Text assets get a brotli variant when the tool is built with libbrotlienc
+// (DIST_PACK_USE_BROTLI, set by OPTION_USE_BROTLI), which is the only build
+// whose browser decodes them. A brotli file the frontend build already wrote
+// next to a file (X.br) is used as it is. Those and gzip files (X.gz) are not
+// packed as files of their own: custom scheme responses are never served with
+// a Content-Encoding.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "replace_me/common/dist_pack_format.h"
+
+#if defined(DIST_PACK_USE_BROTLI)
+#include <brotli/encode.h>
+#endif
+
+namespace {
+
+namespace fs = std::filesystem;
+using namespace client::dist_pack;
+
+struct File {
+  std::string path;  // relative, '/' separated
+  std::string data;
+  std::string variants[kEncodingCount];  // kIdentity unused
+};
+
+// A variant is only kept if it saves at least this fraction of the file.
+constexpr double kMinSaving = 0.1;
+
+// Compressed copies a frontend build may write next to its files.
+constexpr const char* kGzipSuffix = ".gz";
+constexpr const char* kBrotliSuffix = ".br";
+
+fs::path ToPath(const char* utf8) {
+  return fs::path(std::u8string(utf8, utf8 + strlen(utf8)));
+}
+
+std::string ToUtf8(const fs::path& path) {
+  const std::u8string str = path.generic_u8string();
+  return std::string(str.begin(), str.end());
+}
+
+bool EndsWith(const std::string& str, const char* suffix) {
+  const size_t length = strlen(suffix);
+  return str.size() >= length &&
+         str.compare(str.size() - length, length, suffix) == 0;
+}
+
+// Bundler output worth compressing; images, fonts and media already are.
+bool IsCompressible(const std::string& path) {
+  static const char* const kExtensions[] = {
+      ".html", ".htm", ".js",  ".mjs", ".cjs", ".css",  ".json",
+      ".map",  ".svg", ".txt", ".xml", ".wasm", ".ico", ".webmanifest"};
+  for (const char* ext : kExtensions) {
+    if (EndsWith(path, ext)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string Brotli(const std::string& data) {
+#if defined(DIST_PACK_USE_BROTLI)
+  size_t size = BrotliEncoderMaxCompressedSize(data.size());
+  std::string out(size, '\0');
+  if (size == 0 ||
+      !BrotliEncoderCompress(
+          BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+          data.size(), reinterpret_cast<const uint8_t*>(data.data()), &size,
+          reinterpret_cast<uint8_t*>(out.data()))) {
+    return std::string();
+  }
+  out.resize(size);
+  return out;
+#else
+  (void)data;
+  return std::string();
+#endif
+}
+
+// Fills in the variants of every file: the X.br file of the frontend build
+// becomes the variant of X, the others are compressed here. X.gz and X.br
+// files next to X are not packed themselves.
+void AddVariants(std::vector<File>& files) {
+  std::vector<bool> is_variant(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    File& file = files[i];
+    const char* suffix = EndsWith(file.path, kGzipSuffix)     ? kGzipSuffix
+                         : EndsWith(file.path, kBrotliSuffix) ? kBrotliSuffix
+                                                              : nullptr;
+    if (!suffix) {
+      continue;
+    }
+    const std::string base =
+        file.path.substr(0, file.path.size() - strlen(suffix));
+    auto it = std::lower_bound(
+        files.begin(), files.end(), base,
+        [](const File& f, const std::string& path) { return f.path < path; });
+    if (it == files.end() || it->path != base) {
+      continue;
+    }
+#if defined(DIST_PACK_USE_BROTLI)
+    if (suffix == kBrotliSuffix) {
+      it->variants[kBrotli] = std::move(file.data);
+    }
+#endif
+    is_variant[i] = true;
+  }
+  std::vector<File> kept;
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!is_variant[i]) {
+      kept.push_back(std::move(files[i]));
+    }
+  }
+  files = std::move(kept);
+
+  for (File& file : files) {
+    if (!IsCompressible(file.path)) {
+      continue;
+    }
+    if (file.variants[kBrotli].empty()) {
+      file.variants[kBrotli] = Brotli(file.data);
+    }
+  }
+
+  for (File& file : files) {
+    if (file.variants[kBrotli].size() > file.data.size() * (1 - kMinSaving)) {
+      file.variants[kBrotli].clear();
+    }
+  }
+}
+
+uint64_t Align(uint64_t offset) {
+  return (offset + kBlobAlignment - 1) & ~uint64_t(kBlobAlignment - 1);
+}
+
+bool ReadFiles(const fs::path& root, std::vector<File>& files) {
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(root, ec), end; it != end;
+       it.increment(ec)) {
+    if (ec) {
+      break;
+    }
+    if (!it->is_regular_file(ec)) {
+      continue;
+    }
+    std::ifstream in(it->path(), std::ios::binary);
+    File file;
+    file.path = ToUtf8(it->path().lexically_relative(root));
+    file.data.assign(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+    if (!in.good() && !in.eof()) {
+      fprintf(stderr, "dist_pack: failed to read %s\n", file.path.c_str());
+      return false;
+    }
+    files.push_back(std::move(file));
+  }
+  if (ec) {
+    fprintf(stderr, "dist_pack: %s\n", ec.message().c_str());
+    return false;
+  }
+  std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+    return a.path < b.path;
+  });
+  return true;
+}
+
+bool WritePack(const std::vector<File>& files, const fs::path& output) {
+  Header header = {};
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.entry_count = static_cast<uint32_t>(files.size());
+  header.paths_offset = sizeof(Header) + files.size() * sizeof(Entry);
+
+  std::string paths;
+  std::vector<Entry> entries(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    entries[i].path_offset = header.paths_offset + paths.size();
+    entries[i].path_size = static_cast<uint32_t>(files[i].path.size());
+    entries[i].hash = HashOf(files[i].data.data(), files[i].data.size());
+    paths += files[i].path;
+  }
+  header.paths_size = paths.size();
+
+  uint64_t offset = Align(header.paths_offset + paths.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    entries[i].blobs[kIdentity] = {offset, files[i].data.size()};
+    offset = Align(offset + files[i].data.size());
+    for (uint32_t e = kIdentity + 1; e < kEncodingCount; ++e) {
+      if (!files[i].variants[e].empty()) {
+        entries[i].blobs[e] = {offset, files[i].variants[e].size()};
+        offset = Align(offset + files[i].variants[e].size());
+      }
+    }
+  }
+
+  // Written next to the output and renamed, so a failed build never leaves
+  // a truncated archive behind.
+  const fs::path temp = fs::path(output).concat(".tmp");
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+    out.write(paths.data(), static_cast<std::streamsize>(paths.size()));
+    for (size_t i = 0; i < files.size(); ++i) {
+      for (uint32_t e = kIdentity; e < kEncodingCount; ++e) {
+        const Blob& blob = entries[i].blobs[e];
+        if (blob.offset == 0) {
+          continue;
+        }
+        const std::string& data =
+            e == kIdentity ? files[i].data : files[i].variants[e];
+        const uint64_t at = static_cast<uint64_t>(out.tellp());
+        const std::string padding(blob.offset - at, '\0');
+        out.write(padding.data(),
+                  static_cast<std::streamsize>(padding.size()));
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+      }
+    }
+    if (!out.good()) {
+      fprintf(stderr, "dist_pack: failed to write %s\n",
+              ToUtf8(temp).c_str());
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  fs::rename(temp, output, ec);
+  if (ec) {
+    fprintf(stderr, "dist_pack: %s\n", ec.message().c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: dist_pack <dist directory> <output file>\n");
+    return 2;
+  }
+
+  std::vector<File> files;
+  if (!ReadFiles(ToPath(argv[1]), files)) {
+    return 1;
+  }
+  AddVariants(files);
+  if (!WritePack(files, ToPath(argv[2]))) {
+    return 1;
+  }
+
+  size_t sizes[kEncodingCount] = {};
+  size_t counts[kEncodingCount] = {};
+  for (const File& file : files) {
+    sizes[kIdentity] += file.data.size();
+    for (uint32_t e = kIdentity + 1; e < kEncodingCount; ++e) {
+      if (!file.variants[e].empty()) {
+        sizes[e] += file.variants[e].size();
+        ++counts[e];
+      }
+    }
+  }
+  printf("dist_pack: %zu files, %zu bytes; %zu brotli (%zu bytes)\n",
+         files.size(), sizes[kIdentity], counts[kBrotli], sizes[kBrotli]);
+  return 0;
+}
@@ -0,0 +1,73 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_COMPACT_H
+#define __X_PACK_COMPACT_H
+
+#include <fstream>
+#include <stdexcept>
+
+#include "compact_decoder.h"
+#include "compact_encoder.h"
+#include "xpack.h"
+
+namespace xpack {
+
+class compact {
+public:
+    template <class T>
+    static void decode(const std::string &data, T &val) {
+        CompactDecoder de;
+        de.decode(data, val);
+    }
+    template <class T>
+    static void decode(const char *data, size_t length, T &val) {
+        CompactDecoder de;
+        de.decode(data, length, val);
+    }
+    template <class T>
+    static void decode_file(const std::string &file_name, T &val) {
+        CompactDecoder de;
+        de.decode_file(file_name, val);
+    }
+
+    // fieldIds: see CompactEncoder::SetFieldIds
+    template <class T>
+    static std::string encode(const T &val, bool fieldIds = false) {
+        CompactEncoder en;
+        en.SetFieldIds(fieldIds);
+        return en.encode(val);
+    }
+    template <class T>
+    static void encode_file(const T &val, const std::string &file_name, bool fieldIds = false) {
+        std::string data = encode(val, fieldIds);
+        std::ofstream fs(file_name.c_str(), std::ofstream::binary);
+        if (!fs) {
+            std::string err = "Open file["+file_name+"] fail.";
+            throw std::runtime_error(err);
+        }
+        fs.write(data.data(), (std::streamsize)data.size());
+        fs.close();
+        if (!fs) {
+            std::string err = "Write file["+file_name+"] fail.";
+            throw std::runtime_error(err);
+        }
+    }
+};
+
+}
+
+#endif
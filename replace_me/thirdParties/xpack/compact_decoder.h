@@ -0,0 +1,395 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_COMPACT_DECODER_H
+#define __X_PACK_COMPACT_DECODER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "compact_format.h"
+#include "file_mapping.h"
+#include "util.h"
+#include "xdecoder.h"
+
+namespace xpack {
+
+class CompactNode {
+    typedef XDecoder<CompactNode> decoder;
+    friend class CompactDecoder;
+public:
+    typedef const uint8_t* Iterator;
+    // key table of a kFieldIds message
+    typedef std::vector<std::pair<const char*, size_t> > Keys;
+
+    CompactNode(const uint8_t *p = NULL, const uint8_t *end = NULL, const Keys *keys = NULL):_p(p), _end(end), _keys(keys), _body(NULL) {}
+
+    inline static const char * Name() {
+        return "compact";
+    }
+    operator bool () const {
+        return NULL != _p;
+    }
+    bool IsNull() const {
+        return NULL != _p && CompactFormat::kNull == *_p;
+    }
+    CompactNode Find(decoder&de, const char*key, const Extend *ext) {
+        (void)ext;
+        if (!this->Open(de, CompactFormat::kObject)) {
+            de.decode_exception("not object", NULL);
+        }
+
+        // fields are usually decoded in the order they were encoded in, so
+        // the search starts after the last field found and wraps around
+        size_t length = strlen(key);
+        CompactNode child = this->Search(de, _next, _bodyEnd, key, length);
+        if (!child && _next != _body) {
+            child = this->Search(de, _body, _next, key, length);
+        }
+        return child;
+    }
+    size_t Size(decoder&de) {
+        if (!this->Open(de, CompactFormat::kArray)) {
+            de.decode_exception("not array", NULL);
+        }
+        return _count;
+    }
+    CompactNode At(size_t index) const { // no exception, Size opened the array
+        if (index < _index) {
+            _index = 0;
+            _next = _body;
+        }
+        for (; _index<index && NULL!=_next; ++_index) {
+            _next = CompactFormat::Skip(_next, _bodyEnd);
+        }
+        if (NULL == _next || _next >= _bodyEnd) {
+            return CompactNode(); // broken data, Get reports it
+        }
+        return CompactNode(_next, _bodyEnd, _keys);
+    }
+    CompactNode Next(decoder&de, CompactNode&p, Iterator&iter, std::string&key) {
+        if (!p.Open(de, CompactFormat::kObject)) {
+            de.decode_exception("not object", NULL);
+        }
+
+        if (_p == p._p) {
+            iter = p._body;
+        }
+        if (iter == p._bodyEnd) {
+            return CompactNode();
+        }
+
+        const char *name;
+        size_t length;
+        const uint8_t *value;
+        iter = p.Entry(de, iter, name, length, value);
+        key.assign(name, length);
+        return CompactNode(value, p._bodyEnd, _keys);
+    }
+
+    bool Get(decoder&de, std::string&val, const Extend*ext) {
+        (void)ext;
+        const char *data;
+        size_t length;
+        if (this->String(de, data, length)) {
+            val.assign(data, length);
+        }
+        return true;
+    }
+    #ifdef X_PACK_SUPPORT_CXX17
+    // points into the decoded data
+    bool Get(decoder&de, std::string_view&val, const Extend*ext) {
+        (void)ext;
+        const char *data;
+        size_t length;
+        if (this->String(de, data, length)) {
+            val = std::string_view(data, length);
+        }
+        return true;
+    }
+    #endif
+    bool Get(decoder&de, bool &val, const Extend*ext) {
+        (void)ext;
+        uint8_t tag = this->Tag(de);
+        if (CompactFormat::kTrue == tag || CompactFormat::kFalse == tag) {
+            val = (CompactFormat::kTrue == tag);
+        } else if (CompactFormat::kNull == tag) {
+            val = false;
+        } else {
+            int64_t i;
+            if (!this->Integer(de, i)) {
+                de.decode_exception("not bool or integer", NULL);
+            }
+            val = (0 != i);
+        }
+        return true;
+    }
+    template <class T>
+    typename x_enable_if<numeric<T>::is_integer, bool>::type Get(decoder&de, T &val, const Extend*ext){
+        (void)ext;
+        int64_t i;
+        if (this->Integer(de, i)) {
+            val = (T)i;
+        } else if (CompactFormat::kNull == *_p) {
+            val = 0;
+        } else {
+            de.decode_exception("not integer", NULL);
+        }
+        return true;
+    }
+    template <class T>
+    typename x_enable_if<numeric<T>::is_float, bool>::type Get(decoder&de, T &val, const Extend*ext){
+        (void)ext;
+        uint8_t tag = this->Tag(de);
+        int64_t i;
+        if (CompactFormat::kDouble == tag) {
+            uint64_t bits = CompactFormat::GetFixed(this->Payload(de, 8), 8);
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            val = (T)d;
+        } else if (CompactFormat::kFloat == tag) {
+            uint32_t bits = (uint32_t)CompactFormat::GetFixed(this->Payload(de, 4), 4);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            val = (T)f;
+        } else if (this->Integer(de, i)) {
+            val = (CompactFormat::kUint == tag) ? (T)(uint64_t)i : (T)i;
+        } else if (CompactFormat::kNull == tag) {
+            val = 0;
+        } else {
+            de.decode_exception("not number", NULL);
+        }
+        return true;
+    }
+
+private:
+    uint8_t Tag(decoder&de) const {
+        if (NULL == _p) {
+            de.decode_exception("invalid compact data", NULL);
+        }
+        return *_p;
+    }
+    // the length bytes after the tag
+    const uint8_t* Payload(decoder&de, uint64_t length, const uint8_t *p = NULL) const {
+        p = (NULL != p) ? p : _p+1;
+        if (length > (uint64_t)(_end-p)) {
+            de.decode_exception("invalid compact data", NULL);
+        }
+        return p;
+    }
+    uint64_t Varint(decoder&de) const {
+        uint64_t v;
+        if (NULL == CompactFormat::GetVarint(_p+1, _end, v)) {
+            de.decode_exception("invalid compact data", NULL);
+        }
+        return v;
+    }
+
+    // false if the value is no integer. Unsigned integers above INT64_MAX
+    // come back as their two's complement, the cast to T restores them.
+    bool Integer(decoder&de, int64_t &val) const {
+        uint8_t tag = this->Tag(de);
+        if (tag <= CompactFormat::kFixIntMax) {
+            val = tag;
+        } else if (tag >= CompactFormat::kNegFixInt) {
+            val = (int8_t)tag;
+        } else if (CompactFormat::kUint == tag) {
+            val = (int64_t)this->Varint(de);
+        } else if (CompactFormat::kNegInt == tag) {
+            val = (int64_t)~this->Varint(de);
+        } else {
+            return false;
+        }
+        return true;
+    }
+    // false for null
+    bool String(decoder&de, const char *&data, size_t &length) const {
+        uint8_t tag = this->Tag(de);
+        const uint8_t *p = _p+1;
+        uint64_t l;
+        if (tag >= CompactFormat::kFixStr && tag <= CompactFormat::kFixStr+CompactFormat::kFixStrMax) {
+            l = tag-CompactFormat::kFixStr;
+        } else if (CompactFormat::kString == tag) {
+            p = CompactFormat::GetVarint(p, _end, l);
+            if (NULL == p) {
+                de.decode_exception("invalid compact data", NULL);
+            }
+        } else if (CompactFormat::kNull == tag) {
+            return false;
+        } else {
+            de.decode_exception("not string", NULL);
+            return false;
+        }
+        data = (const char*)this->Payload(de, l, p);
+        length = (size_t)l;
+        return true;
+    }
+
+    // reads the container header, false if this is no container of type tag
+    bool Open(decoder&de, uint8_t tag) {
+        if (NULL == _p || tag != *_p) {
+            return false;
+        }
+        if (NULL != _body) {
+            return true;
+        }
+        const uint8_t *p = _p+1;
+        uint64_t count = 0;
+        uint64_t size = 0;
+        if (CompactFormat::kArray == tag) {
+            p = CompactFormat::GetVarint(p, _end, count);
+        }
+        if (NULL != p) {
+            p = CompactFormat::GetVarint(p, _end, size);
+        }
+        // every element takes a byte at least, which bounds the resize of
+        // the vector decoded into
+        if (NULL == p || size > (uint64_t)(_end-p) || count > size) {
+            de.decode_exception("invalid compact data", NULL);
+        }
+        _body = p;
+        _bodyEnd = p+size;
+        _count = (size_t)count;
+        _next = p;
+        _index = 0;
+        return true;
+    }
+
+    // reads the object entry at p, returns its end
+    const uint8_t* Entry(decoder&de, const uint8_t *p, const char *&name, size_t &length, const uint8_t *&value) const {
+        uint64_t v;
+        p = CompactFormat::GetVarint(p, _bodyEnd, v);
+        if (NULL != p && NULL != _keys) {
+            if (v >= _keys->size()) {
+                de.decode_exception("invalid compact data", NULL);
+            }
+            name = (*_keys)[(size_t)v].first;
+            length = (*_keys)[(size_t)v].second;
+        } else if (NULL != p) {
+            if (v > (uint64_t)(_bodyEnd-p)) {
+                de.decode_exception("invalid compact data", NULL);
+            }
+            name = (const char*)p;
+            length = (size_t)v;
+            p += length;
+        }
+        value = p;
+        p = (NULL != p) ? CompactFormat::Skip(p, _bodyEnd) : NULL;
+        if (NULL == p) {
+            de.decode_exception("invalid compact data", NULL);
+        }
+        return p;
+    }
+
+    CompactNode Search(decoder&de, const uint8_t *p, const uint8_t *end, const char *key, size_t length) {
+        while (p < end) {
+            const char *name;
+            size_t l;
+            const uint8_t *value;
+            p = this->Entry(de, p, name, l, value);
+            if (l == length && 0 == memcmp(name, key, length)) {
+                _next = p;
+                return CompactNode(value, _bodyEnd, _keys);
+            }
+        }
+        return CompactNode();
+    }
+
+    const uint8_t *_p;      // tag
+    const uint8_t *_end;    // end of the enclosing container
+    const Keys *_keys;
+
+    // containers, set by Open
+    const uint8_t *_body;
+    const uint8_t *_bodyEnd;
+    size_t _count;
+    mutable const uint8_t *_next;   // entry after the last one found
+    mutable size_t _index;          // index of the element at _next
+};
+
+
+/*
+  Decodes data written by CompactEncoder. Data that is truncated or otherwise
+  broken is reported with an exception, never read past its end.
+  std::string_view members point into the data, so they need it to outlive
+  the decoded value (decode_file unmaps the file when it returns).
+*/
+class CompactDecoder {
+public:
+    template <class T>
+    bool decode(const char *data, size_t length, T&val) {
+        const uint8_t *p = (const uint8_t*)data;
+        const uint8_t *end = p+length;
+        if (length < 2 || CompactFormat::kMagic != p[0]) {
+            throw std::runtime_error("not compact data");
+        }
+        uint8_t flags = p[1];
+        if (0 != (flags&~CompactFormat::kFieldIds)) {
+            throw std::runtime_error("unsupported compact data");
+        }
+        p += 2;
+
+        CompactNode::Keys keys;
+        if (0 != (flags&CompactFormat::kFieldIds)) {
+            uint64_t count;
+            p = CompactFormat::GetVarint(p, end, count);
+            if (NULL == p || count > (uint64_t)(end-p)) {
+                throw std::runtime_error("invalid compact data");
+            }
+            keys.reserve((size_t)count);
+            for (uint64_t i=0; i<count; ++i) {
+                uint64_t l;
+                p = CompactFormat::GetVarint(p, end, l);
+                if (NULL == p || l > (uint64_t)(end-p)) {
+                    throw std::runtime_error("invalid compact data");
+                }
+                keys.push_back(std::make_pair((const char*)p, (size_t)l));
+                p += l;
+            }
+        }
+        if (CompactFormat::Skip(p, end) != end) {
+            throw std::runtime_error("invalid compact data");
+        }
+
+        CompactNode node(p, end, (0 != (flags&CompactFormat::kFieldIds)) ? &keys : NULL);
+        return XDecoder<CompactNode>(NULL, (const char*)NULL, node).decode(val, NULL);
+    }
+
+    template <class T>
+    bool decode(const std::string&data, T&val) {
+        return this->decode(data.data(), data.length(), val);
+    }
+
+    template <class T>
+    bool decode_file(const std::string &fname, T&val) {
+        FileMapping file;
+        if (!file.Map(fname)) {
+            std::string data;
+            Util::readfile(fname, data);
+            return this->decode(data, val);
+        }
+        file.AdviseSequential();
+        return this->decode(file.Data(), file.Size(), val);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,305 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_COMPACT_ENCODER_H
+#define __X_PACK_COMPACT_ENCODER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "compact_format.h"
+#include "field_index.h"
+#include "xencoder.h"
+
+namespace xpack {
+
+class CompactWriter: private noncopyable {
+    friend class XEncoder<CompactWriter>;
+    friend class CompactEncoder;
+    const static bool support_null = true;
+public:
+    // fieldIds: write each object key once, in the key table, and refer to it
+    // by its index
+    explicit CompactWriter(bool fieldIds = false):_fieldIds(fieldIds) {
+        if (!fieldIds) {
+            _out.push_back((char)CompactFormat::kMagic);
+            _out.push_back(0);
+        } else {
+            _slots.resize(64, 0);
+        }
+    }
+
+private:
+    struct Level {
+        size_t header;  // offset of the tag
+        size_t count;
+        bool array;
+    };
+
+    inline static const char *Name() {
+        return "compact";
+    }
+    inline const char *IndexKey(size_t index) {
+        (void)index;
+        return NULL;
+    }
+    // hands over the encoded data, the writer is empty afterwards
+    std::string String() {
+        std::string ret;
+        if (!_fieldIds) {
+            ret.swap(_out);
+            return ret;
+        }
+        size_t tableSize = CompactFormat::kMaxVarint;
+        for (size_t i=0; i<_names.size(); ++i) {
+            tableSize += CompactFormat::kMaxVarint+_names[i].length();
+        }
+        ret.reserve(2+tableSize+_out.size());
+        ret.push_back((char)CompactFormat::kMagic);
+        ret.push_back((char)CompactFormat::kFieldIds);
+        CompactFormat::PutVarint(ret, _names.size());
+        for (size_t i=0; i<_names.size(); ++i) {
+            CompactFormat::PutVarint(ret, _names[i].length());
+            ret.append(_names[i]);
+        }
+        ret.append(_out);
+        return ret;
+    }
+
+    void ArrayBegin(const char *key, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        this->Open(true);
+    }
+    void ArrayEnd(const char *key, const Extend *ext) {
+        (void)key;
+        (void)ext;
+        this->Close();
+    }
+    void ObjectBegin(const char *key, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        this->Open(false);
+    }
+    void ObjectEnd(const char *key, const Extend *ext) {
+        (void)key;
+        (void)ext;
+        this->Close();
+    }
+    bool WriteNull(const char*key, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        _out.push_back((char)CompactFormat::kNull);
+        return true;
+    }
+    bool encode_bool(const char*key, const bool &val, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        _out.push_back((char)(val ? CompactFormat::kTrue : CompactFormat::kFalse));
+        return true;
+    }
+    bool encode_string(const char*key, const char*val, size_t length, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        if (length <= CompactFormat::kFixStrMax) {
+            _out.push_back((char)(CompactFormat::kFixStr+length));
+        } else {
+            _out.push_back((char)CompactFormat::kString);
+            CompactFormat::PutVarint(_out, length);
+        }
+        _out.append(val, length);
+        return true;
+    }
+    bool encode_string(const char*key, const std::string& val, const Extend *ext) {
+        return this->encode_string(key, val.data(), val.length(), ext);
+    }
+    bool encode_string(const char*key, const char* val, const Extend *ext) {
+        if (NULL == val) {
+            return this->encode_string(key, "", 0, ext);
+        }
+        return this->encode_string(key, val, strlen(val), ext);
+    }
+    template <typename T>
+    typename x_enable_if<numeric<T>::is_integer && numeric<T>::is_signed, bool>::type encode_number(const char*key, const T&val, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        int64_t v = (int64_t)val;
+        if (v >= 0) {
+            this->PutUint((uint64_t)v);
+        } else if (v >= -32) {
+            _out.push_back((char)(uint8_t)v); // 0xe0-0xff
+        } else {
+            _out.push_back((char)CompactFormat::kNegInt);
+            CompactFormat::PutVarint(_out, ~(uint64_t)v);
+        }
+        return true;
+    }
+    template <typename T>
+    typename x_enable_if<numeric<T>::is_integer && !numeric<T>::is_signed, bool>::type encode_number(const char*key, const T&val, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        this->PutUint((uint64_t)val);
+        return true;
+    }
+    bool encode_number(const char*key, const float&val, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        uint32_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        _out.push_back((char)CompactFormat::kFloat);
+        CompactFormat::PutFixed(_out, bits, sizeof(bits));
+        return true;
+    }
+    bool encode_number(const char*key, const double&val, const Extend *ext) {
+        (void)ext;
+        this->Key(key);
+        uint64_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        _out.push_back((char)CompactFormat::kDouble);
+        CompactFormat::PutFixed(_out, bits, sizeof(bits));
+        return true;
+    }
+    bool encode_number(const char*key, const long double&val, const Extend *ext) {
+        double d = (double)val;
+        return this->encode_number(key, d, ext);
+    }
+
+    void PutUint(uint64_t v) {
+        if (v <= CompactFormat::kFixIntMax) {
+            _out.push_back((char)v);
+        } else {
+            _out.push_back((char)CompactFormat::kUint);
+            CompactFormat::PutVarint(_out, v);
+        }
+    }
+
+    // every value starts here: counts array elements, writes object keys
+    void Key(const char *key) {
+        if (_levels.empty()) {
+            return;
+        }
+        Level &level = _levels.back();
+        if (level.array) {
+            ++level.count;
+            return;
+        }
+        size_t length = (NULL != key) ? strlen(key) : 0;
+        if (_fieldIds) {
+            CompactFormat::PutVarint(_out, this->KeyId(key, length));
+        } else {
+            CompactFormat::PutVarint(_out, length);
+            _out.append(key, length);
+        }
+    }
+
+    // A container header is written with one byte for each varint and
+    // widened in Close when the body turns out to be larger, so only
+    // containers of 128 bytes or more are moved.
+    void Open(bool array) {
+        Level level = {_out.size(), 0, array};
+        _levels.push_back(level);
+        _out.push_back((char)(array ? CompactFormat::kArray : CompactFormat::kObject));
+        _out.append(array ? 2 : 1, '\0');
+    }
+    void Close() {
+        Level level = _levels.back();
+        _levels.pop_back();
+
+        size_t reserved = level.array ? 2 : 1;
+        size_t body = _out.size()-level.header-1-reserved;
+        uint8_t buf[2*CompactFormat::kMaxVarint];
+        uint8_t *p = buf;
+        if (level.array) {
+            p = CompactFormat::WriteVarint(p, level.count);
+        }
+        p = CompactFormat::WriteVarint(p, body);
+        size_t length = (size_t)(p-buf);
+        if (length == reserved) {
+            memcpy(&_out[level.header+1], buf, length);
+        } else {
+            _out.replace(level.header+1, reserved, (const char*)buf, length);
+        }
+    }
+
+    // index of key in the key table, added on first use
+    size_t KeyId(const char *key, size_t length) {
+        size_t mask = _slots.size()-1;
+        size_t i = FieldIndex::Hash(key, length)&mask;
+        for (; _slots[i] != 0; i=(i+1)&mask) {
+            const std::string &name = _names[_slots[i]-1];
+            if (name.length() == length && 0 == memcmp(name.data(), key, length)) {
+                return _slots[i]-1;
+            }
+        }
+        _names.push_back(std::string(key, length));
+        _slots[i] = _names.size();
+        if (_names.size()*2 > _slots.size()) {
+            this->Rehash(_slots.size()*2);
+        }
+        return _names.size()-1;
+    }
+    void Rehash(size_t size) {
+        _slots.assign(size, 0);
+        for (size_t id=0; id<_names.size(); ++id) {
+            size_t i = FieldIndex::Hash(_names[id].data(), _names[id].length())&(size-1);
+            while (_slots[i] != 0) {
+                i = (i+1)&(size-1);
+            }
+            _slots[i] = id+1;
+        }
+    }
+
+    bool _fieldIds;
+    std::string _out;
+    std::vector<Level> _levels;
+    std::vector<std::string> _names;    // key table
+    std::vector<size_t> _slots;         // hash table of _names, index + 1
+};
+
+/*
+  Encodes to the compact binary format described in compact_format.h, for
+  IPC and caches where both ends are xpack: integers are varints, floats keep
+  their bits, strings are length prefixed and nothing is escaped.
+*/
+class CompactEncoder {
+public:
+    CompactEncoder():_fieldIds(false) {
+    }
+
+    // Write each object key once, in a key table at the front, and refer to
+    // it by index. Smaller for arrays of structs, a little slower to encode.
+    void SetFieldIds(bool fieldIds) {
+        _fieldIds = fieldIds;
+    }
+
+    template <class T>
+    std::string encode(const T&val) {
+        CompactWriter wr(_fieldIds);
+        XEncoder<CompactWriter> en(wr);
+        en.encode(NULL, val, NULL);
+        return wr.String();
+    }
+
+private:
+    bool _fieldIds;
+};
+
+}
+
+#endif
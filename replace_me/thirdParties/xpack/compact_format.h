@@ -0,0 +1,169 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_COMPACT_FORMAT_H
+#define __X_PACK_COMPACT_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+namespace xpack {
+
+/*
+  Binary format of CompactEncoder/CompactDecoder. It is in the spirit of
+  MessagePack but not compatible with it, and needs no library.
+
+  message:  kMagic, flags, [key table if kFieldIds], value
+  key table: varint count, count * (varint length, bytes)
+
+  value, by its first byte:
+    0x00-0x7f  integer 0-127
+    0x80       null
+    0x81/0x82  false/true
+    0x83       unsigned integer, varint
+    0x84       negative integer v, varint of -1-v
+    0x85/0x86  float/double, 4/8 bytes little endian
+    0x87       string, varint length, bytes
+    0x88       array, varint count, varint body size, count * value
+    0x89       object, varint body size, (key, value)*
+    0xa0-0xbf  string of 0-31 bytes, bytes
+    0xe0-0xff  integer -32 to -1
+
+  Varints are little endian base 128 (LEB128). An object key is a varint
+  length and the bytes of the name, or with kFieldIds the varint index of the
+  name in the key table. Containers carry their body size, so a decoder skips
+  a value it does not need without reading it.
+*/
+class CompactFormat {
+public:
+    static const uint8_t kMagic = 0xc5;
+    static const uint8_t kFieldIds = 0x01;      // flag: keys are key table indexes
+
+    static const uint8_t kFixIntMax = 0x7f;
+    static const uint8_t kNull = 0x80;
+    static const uint8_t kFalse = 0x81;
+    static const uint8_t kTrue = 0x82;
+    static const uint8_t kUint = 0x83;
+    static const uint8_t kNegInt = 0x84;
+    static const uint8_t kFloat = 0x85;
+    static const uint8_t kDouble = 0x86;
+    static const uint8_t kString = 0x87;
+    static const uint8_t kArray = 0x88;
+    static const uint8_t kObject = 0x89;
+    static const uint8_t kFixStr = 0xa0;
+    static const uint8_t kFixStrMax = 31;
+    static const uint8_t kNegFixInt = 0xe0;     // -32
+
+    static const size_t kMaxVarint = 10;
+
+    static size_t VarintSize(uint64_t v) {
+        size_t n = 1;
+        while (v >= 0x80) {
+            v >>= 7;
+            ++n;
+        }
+        return n;
+    }
+    // writes v at p, returns the end
+    static uint8_t* WriteVarint(uint8_t *p, uint64_t v) {
+        while (v >= 0x80) {
+            *p++ = (uint8_t)(v|0x80);
+            v >>= 7;
+        }
+        *p++ = (uint8_t)v;
+        return p;
+    }
+    static void PutVarint(std::string &out, uint64_t v) {
+        if (v < 0x80) {
+            out.push_back((char)v);
+            return;
+        }
+        uint8_t buf[kMaxVarint];
+        out.append((const char*)buf, (size_t)(WriteVarint(buf, v)-buf));
+    }
+    // reads a varint from [p, end), NULL if it does not fit
+    static const uint8_t* GetVarint(const uint8_t *p, const uint8_t *end, uint64_t &v) {
+        if (p < end && *p < 0x80) { // most varints are a byte
+            v = *p;
+            return p+1;
+        }
+        v = 0;
+        for (unsigned shift=0; p<end && shift<64; shift+=7) {
+            uint8_t b = *p++;
+            v |= (uint64_t)(b&0x7f)<<shift;
+            if (b < 0x80) {
+                return p;
+            }
+        }
+        return NULL;
+    }
+
+    static void PutFixed(std::string &out, uint64_t bits, size_t bytes) {
+        uint8_t buf[8];
+        for (size_t i=0; i<bytes; ++i) {
+            buf[i] = (uint8_t)(bits>>(8*i));
+        }
+        out.append((const char*)buf, bytes);
+    }
+    static uint64_t GetFixed(const uint8_t *p, size_t bytes) {
+        uint64_t bits = 0;
+        for (size_t i=0; i<bytes; ++i) {
+            bits |= (uint64_t)p[i]<<(8*i);
+        }
+        return bits;
+    }
+
+    // end of the value at p, NULL if it does not fit in [p, end)
+    static const uint8_t* Skip(const uint8_t *p, const uint8_t *end) {
+        if (p >= end) {
+            return NULL;
+        }
+        uint8_t tag = *p++;
+        uint64_t length = 0;
+        if (tag <= kFixIntMax || tag >= kNegFixInt || tag == kNull || tag == kFalse || tag == kTrue) {
+            return p;
+        } else if (tag >= kFixStr && tag <= kFixStr+kFixStrMax) {
+            length = tag-kFixStr;
+        } else if (tag == kUint || tag == kNegInt) {
+            return GetVarint(p, end, length);
+        } else if (tag == kFloat) {
+            length = 4;
+        } else if (tag == kDouble) {
+            length = 8;
+        } else if (tag == kString || tag == kObject) {
+            p = GetVarint(p, end, length);
+        } else if (tag == kArray) {
+            uint64_t count;
+            p = GetVarint(p, end, count);
+            if (NULL != p) {
+                p = GetVarint(p, end, length);
+            }
+        } else {
+            return NULL;
+        }
+        if (NULL == p || length > (uint64_t)(end-p)) {
+            return NULL;
+        }
+        return p+length;
+    }
+};
+
+}
+
+#endif
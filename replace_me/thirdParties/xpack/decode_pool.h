@@ -0,0 +1,166 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_DECODE_POOL_H
+#define __X_PACK_DECODE_POOL_H
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xpack {
+
+/*
+  Threads that decode the elements of large arrays in parallel. While a
+  DecodePool::Scope is alive on a thread, decodes on that thread split every
+  std::vector (or QVector) of at least MinElements() elements into ranges and
+  decode them on the pool, the calling thread included. Arrays nested in the
+  elements are decoded serially by the thread that decodes the element.
+
+  Only nodes marked with is_parallel_node, which can be read from several
+  threads at once, are decoded in parallel (JsonNode, the DOM decoder). If
+  elements fail, the error of the first failing element is thrown, as a serial
+  decode would.
+
+  The pool joins its threads when destroyed, so do not keep one in a static
+  of a library that may be unloaded.
+*/
+class DecodePool {
+public:
+    static const size_t kMinElements = 1024;
+
+    // threads includes the thread that runs the decode, so threads-1 are started
+    explicit DecodePool(size_t threads, size_t minElements = kMinElements):_min(minElements), _stop(false) {
+        for (size_t i=1; i<threads; ++i) {
+            _workers.push_back(std::thread(&DecodePool::Work, this));
+        }
+    }
+    ~DecodePool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _work.notify_all();
+        for (size_t i=0; i<_workers.size(); ++i) {
+            _workers[i].join();
+        }
+    }
+
+    size_t Threads() const {
+        return _workers.size()+1;
+    }
+    size_t MinElements() const {
+        return _min;
+    }
+
+    // pool used by decodes on the calling thread, NULL outside a Scope
+    static DecodePool*& Current() {
+        static thread_local DecodePool *pool = NULL;
+        return pool;
+    }
+
+    class Scope {
+    public:
+        explicit Scope(DecodePool *pool):_prev(Current()) {
+            Current() = pool;
+        }
+        ~Scope() {
+            Current() = _prev;
+        }
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+
+        DecodePool *_prev;
+    };
+
+    // calls run(ctx, task) for each task in [0, tasks) and returns when all
+    // are done. run must not throw.
+    void Run(size_t tasks, void (*run)(void *ctx, size_t task), void *ctx) {
+        Batch batch = {run, ctx, tasks, 0, 0};
+        std::unique_lock<std::mutex> lock(_mutex);
+        _queue.push_back(&batch);
+        _work.notify_all();
+        while (Step(lock, batch)) {
+        }
+        _done.wait(lock, [&batch]{ return batch.done == batch.tasks; });
+    }
+
+private:
+    DecodePool(const DecodePool&);
+    DecodePool& operator=(const DecodePool&);
+
+    struct Batch {
+        void (*run)(void *ctx, size_t task);
+        void *ctx;
+        size_t tasks;
+        size_t next;    // guarded by _mutex
+        size_t done;    // guarded by _mutex
+    };
+
+    // runs the next task of batch, false and off the queue once all are taken
+    bool Step(std::unique_lock<std::mutex> &lock, Batch &batch) {
+        if (batch.next >= batch.tasks) {
+            std::deque<Batch*>::iterator it = std::find(_queue.begin(), _queue.end(), &batch);
+            if (it != _queue.end()) {
+                _queue.erase(it);
+            }
+            return false;
+        }
+        size_t task = batch.next++;
+        lock.unlock();
+        batch.run(batch.ctx, task);
+        lock.lock();
+        if (++batch.done == batch.tasks) {
+            _done.notify_all();
+        }
+        return true;
+    }
+
+    void Work() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _work.wait(lock, [this]{ return _stop || !_queue.empty(); });
+            if (_stop) {
+                return;
+            }
+            Step(lock, *_queue.front());
+        }
+    }
+
+    size_t _min;
+    bool _stop;
+    std::mutex _mutex;
+    std::condition_variable _work;
+    std::condition_variable _done;
+    std::deque<Batch*> _queue;
+    std::vector<std::thread> _workers;
+};
+
+// Node types whose reads are safe from several threads at once
+template <class Node>
+struct is_parallel_node {
+    static const bool value = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_DECODE_RESULT_H
+#define __X_PACK_DECODE_RESULT_H
+
+#include <stddef.h>
+
+#include <string>
+
+#include "traits.h"
+
+namespace xpack {
+
+/*
+  Outcome of a try_decode. Instead of throwing std::runtime_error, a decoder
+  given a DecodeResult records the first error here and stops decoding: the
+  remaining fields are skipped and val is left partly decoded.
+
+  Parse errors have the offset of the error in the text and no path, decode
+  errors (a value of the wrong type, a missing mandatory key) have the path
+  of the value and no offset.
+*/
+class DecodeResult {
+public:
+    static const size_t npos = (size_t)-1;
+
+    DecodeResult():_failed(false), _decode(false), _offset(npos) {}
+
+    bool Ok() const {
+        return !_failed;
+    }
+    #ifdef X_PACK_SUPPORT_CXX0X
+    explicit operator bool() const {
+        return !_failed;
+    }
+    #endif
+
+    // "not integer", "Parse json fail. err=..."
+    const std::string& What() const {
+        return _what;
+    }
+    // "items[3].id", empty for parse errors
+    const std::string& Path() const {
+        return _path;
+    }
+    // byte offset of a parse error, npos otherwise
+    size_t Offset() const {
+        return _offset;
+    }
+    // the text the throwing decode would have put in its exception. Decode
+    // errors carry the path even at the root ("not object. (path:)")
+    std::string Message() const {
+        if (!_decode && _path.empty()) {
+            return _what;
+        }
+        return _what+". (path:"+_path+")";
+    }
+
+    // the first error wins, later ones are ignored
+    void Fail(const std::string &what, const std::string &path, size_t offset = npos) {
+        if (!_failed) {
+            _failed = true;
+            _what = what;
+            _path = path;
+            _offset = offset;
+        }
+    }
+    // error of a decoder at path, see Message
+    void FailDecode(const std::string &what, const std::string &path) {
+        if (!_failed) {
+            Fail(what, path);
+            _decode = true;
+        }
+    }
+
+private:
+    bool _failed;
+    bool _decode;
+    std::string _what;
+    std::string _path;
+    size_t _offset;
+};
+
+}
+
+#endif
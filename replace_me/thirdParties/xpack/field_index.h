@@ -0,0 +1,219 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_FIELD_INDEX_H
+#define __X_PACK_FIELD_INDEX_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "extend.h"
+#include "traits.h"
+
+namespace xpack {
+
+/*
+  Fields of an XPACK/XPACK_OUT struct, in the order in which __x_pack_decode
+  visits them, with a hash table from name to field number.
+
+  The index is built once per struct and decoder type by running the decode
+  function generated by XPACK with a collector instead of a decoder, so
+  aliases (for the decoder's Name()) and inherited fields are included.
+  Custom codecs must visit the same fields on every call for the index to be
+  accurate.
+
+  A field that is a member of the struct itself (or of a base) also gets its
+  offset in the struct and Decoder::decode_thunk<M>, so the decoder can fill
+  it without going through __x_pack_decode. Bitfields and fields visited by
+  a custom codec have no thunk: they are decoded into temporaries or need the
+  codec's own code to run.
+*/
+class FieldIndex {
+public:
+    static const size_t npos = (size_t)-1;
+
+    // decodes the field at field, ext and key as passed by __x_pack_decode
+    typedef bool (*Thunk)(void *decoder, void *field, const Extend *ext, const char *key);
+
+    struct Field {
+        std::string name;
+        Extend ext;
+        size_t offset;      // in the struct, npos if there is no thunk
+        Thunk thunk;
+
+        Field(const char *_name, const Extend *_ext):name(_name), ext(_ext), offset(npos), thunk(NULL) {}
+    };
+
+    template <class T, class Decoder>
+    static const FieldIndex& Get() {
+        static const FieldIndex index(Collect<T, Decoder>());
+        return index;
+    }
+
+    // 32-bit FNV-1a
+    static uint32_t Hash(const char *data, size_t length) {
+        uint32_t h = 2166136261u;
+        for (size_t i=0; i<length; ++i) {
+            h ^= (unsigned char)data[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    size_t Size() const {
+        return _fields.size();
+    }
+    const Field& At(size_t field) const {
+        return _fields[field];
+    }
+    const std::string& Name(size_t field) const {
+        return _fields[field].name;
+    }
+
+    // number of the first field called key, or npos
+    size_t Find(const char *key, size_t length) const {
+        uint32_t h = Hash(key, length);
+        for (size_t i=h&_mask; ; i=(i+1)&_mask) {
+            const Slot &slot = _slots[i];
+            if (slot.field == 0) {
+                return npos;
+            }
+            const std::string &name = _fields[slot.field-1].name;
+            if (slot.hash == h && name.length() == length && 0 == memcmp(name.data(), key, length)) {
+                return slot.field-1;
+            }
+        }
+    }
+
+    // passed to __x_pack_decode in place of a decoder, records the fields
+    template <class Decoder>
+    class Collector {
+    public:
+        Collector(const char *base, size_t size, std::vector<Field> &fields):_base(base), _size(size), _custom(0), _fields(fields) {}
+
+        const char *Name() const {
+            return Decoder::Name();
+        }
+
+        template <class T>
+        bool decode(const char*key, T&val, const Extend*ext) {
+            Field f(key, ext);
+            const char *p = (const char*)&val;
+            if (0 == _custom && p >= _base && p+sizeof(T) <= _base+_size) {
+                f.offset = (size_t)(p-_base);
+                f.thunk = &Decoder::template decode_thunk<T>;
+            }
+            _fields.push_back(f);
+            return false;
+        }
+        template <class T>
+        bool decode(T&val, const Extend*ext) {
+            if (0 != (X_PACK_CTRL_FLAG_INHERIT&Extend::CtrlFlag(ext))) {
+                Fields(*this, val);
+            }
+            return false;
+        }
+        void decode_exception(const char* what, const char *key) const {
+            (void)what; (void)key;
+        }
+
+        // see CustomDecodeScope
+        void custom(int step) {
+            _custom += step;
+        }
+
+    private:
+        const char *_base;
+        size_t _size;
+        int _custom;
+        std::vector<Field> &_fields;
+    };
+
+private:
+    struct Slot {
+        uint32_t hash;
+        uint32_t field;     // field number + 1, 0 for an empty slot
+    };
+
+    template <class T, class C>
+    static typename x_enable_if<T::__x_pack_value && !is_xpack_out<T>::value, void>::type Fields(C &c, T &val) {
+        val.__x_pack_decode(c, val, NULL);
+    }
+    template <class T, class C>
+    static typename x_enable_if<is_xpack_out<T>::value, void>::type Fields(C &c, T &val) {
+        __x_pack_decode_out(c, val, NULL);
+    }
+
+    template <class T, class Decoder>
+    static std::vector<Field> Collect() {
+        std::vector<Field> fields;
+        T val;
+        Collector<Decoder> c((const char*)&val, sizeof(T), fields);
+        Fields(c, val);
+        return fields;
+    }
+
+    explicit FieldIndex(const std::vector<Field> &fields):_fields(fields) {
+        size_t size = 4;
+        while (size < fields.size()*2) {
+            size *= 2;
+        }
+        _mask = size-1;
+        _slots.resize(size);
+        for (size_t i=0; i<size; ++i) {
+            _slots[i].hash = 0;
+            _slots[i].field = 0;
+        }
+
+        for (size_t f=0; f<fields.size(); ++f) {
+            const std::string &name = fields[f].name;
+            if (npos != Find(name.data(), name.length())) {
+                continue; // keep the first field of a name
+            }
+            uint32_t h = Hash(name.data(), name.length());
+            size_t i = h&_mask;
+            while (_slots[i].field != 0) {
+                i = (i+1)&_mask;
+            }
+            _slots[i].hash = h;
+            _slots[i].field = (uint32_t)f+1;
+        }
+    }
+
+    std::vector<Field> _fields;
+    std::vector<Slot> _slots;
+    size_t _mask;
+};
+
+// fields decoded by a custom codec get no thunk
+template <class Decoder>
+struct CustomDecodeScope<FieldIndex::Collector<Decoder> > {
+    explicit CustomDecodeScope(FieldIndex::Collector<Decoder> &c):_c(c) {
+        _c.custom(1);
+    }
+    ~CustomDecodeScope() {
+        _c.custom(-1);
+    }
+private:
+    FieldIndex::Collector<Decoder> &_c;
+};
+
+}
+
+#endif
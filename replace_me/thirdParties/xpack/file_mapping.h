@@ -0,0 +1,161 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_FILE_MAPPING_H
+#define __X_PACK_FILE_MAPPING_H
+
+#include <stddef.h>
+
+#include <string>
+
+#ifdef _WIN32
+  #ifndef NOMINMAX
+  #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace xpack {
+
+/*
+  Read-only memory mapping of a whole file, used by the decode_file functions
+  instead of reading the file into a std::string.
+
+  Map() fails for files that cannot be mapped (empty files, pipes, special
+  files); callers then fall back to Util::readfile, which also reports files
+  that cannot be opened. A copy_on_write mapping may be written to, the changes
+  stay in this process and never reach the file.
+*/
+class FileMapping {
+public:
+    FileMapping():_data(NULL), _size(0) {}
+    ~FileMapping() {
+        Unmap();
+    }
+
+    bool Map(const std::string &fname, bool copy_on_write = false) {
+        Unmap();
+    #ifdef _WIN32
+        // same narrow file name as std::ifstream in Util::readfile
+        HANDLE file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (INVALID_HANDLE_VALUE == file) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        HANDLE mapping = NULL;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && (unsigned long long)size.QuadPart <= (size_t)-1) {
+            mapping = CreateFileMappingA(file, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+        }
+        CloseHandle(file);
+        if (NULL == mapping) {
+            return false;
+        }
+        void *data = MapViewOfFile(mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);   // the view keeps the mapping alive
+        if (NULL == data) {
+            return false;
+        }
+        _size = (size_t)size.QuadPart;
+    #else
+        int fd = open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        void *data = MAP_FAILED;
+        if (0 == fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+            int prot = copy_on_write ? PROT_READ|PROT_WRITE : PROT_READ;
+            data = mmap(NULL, (size_t)st.st_size, prot, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);              // the mapping keeps the file open
+        if (MAP_FAILED == data) {
+            return false;
+        }
+        _size = (size_t)st.st_size;
+    #endif
+        _data = (char*)data;
+        return true;
+    }
+
+    // tells the OS the file will be read front to back
+    void AdviseSequential() {
+        if (NULL == _data) {
+            return;
+        }
+    #ifdef _WIN32
+        #if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+        WIN32_MEMORY_RANGE_ENTRY range = {_data, _size};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+        #endif
+    #else
+        // advice values are not flags, each one takes a call of its own
+        madvise(_data, _size, MADV_SEQUENTIAL);
+        madvise(_data, _size, MADV_WILLNEED);
+    #endif
+    }
+
+    char *Data() const {
+        return _data;
+    }
+    size_t Size() const {
+        return _size;
+    }
+
+    // the rest of the last page is zero filled, so unless the file ends on a
+    // page boundary a NUL follows the data
+    bool Terminated() const {
+        return NULL != _data && 0 != _size%PageSize();
+    }
+
+private:
+    FileMapping(const FileMapping&);
+    FileMapping& operator=(const FileMapping&);
+
+    static size_t PageSize() {
+    #ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+    #else
+        return (size_t)sysconf(_SC_PAGESIZE);
+    #endif
+    }
+
+    void Unmap() {
+        if (NULL == _data) {
+            return;
+        }
+    #ifdef _WIN32
+        UnmapViewOfFile(_data);
+    #else
+        munmap(_data, _size);
+    #endif
+        _data = NULL;
+        _size = 0;
+    }
+
+    char *_data;
+    size_t _size;
+};
+
+}
+
+#endif
@@ -22,15 +22,24 @@
 #if defined(X_PACK_SUPPORT_CXX0X) || defined (_GNU_SOURCE)
 #include "json_data.h"
 #endif
+#ifdef X_PACK_SUPPORT_CXX0X
+#include "json_arena.h"
+#include "json_sax_decoder.h"
+#include "json_schema.h"
+#include "json_lazy.h"
+#endif
 #include "xpack.h"
 
 namespace xpack {
 
 class json {
 public:
+    // mode: how numbers are read and written, see JsonNumberMode. Only the
+    // call it is passed to is affected
     template <class T>
-    static void decode(const std::string &data, T &val) {
+    static void decode(const std::string &data, T &val, JsonNumberMode mode = kJsonNumberDefault) {
         JsonDecoder de;
+        de.SetNumberMode(mode);
         de.decode(data, val);
     }
     template <class T>
@@ -39,23 +48,194 @@ public:
         XDecoder<JsonNode>(NULL, (const char*)NULL, node).decode(val, NULL);
     }
     template <class T>
-    static void decode_file(const std::string &file_name, T &val) {
+    static void decode_file(const std::string &file_name, T &val, JsonNumberMode mode = kJsonNumberDefault) {
         JsonDecoder de;
+        de.SetNumberMode(mode);
         de.decode_file(file_name, val);
     }
+    // Parses the text in place. std::string_view/std::span<const char> members
+    // of val point into text, see JsonInsitu
+    template <class T>
+    static void decode(JsonInsitu &text, T &val, JsonNumberMode mode = kJsonNumberDefault) {
+        rapidjson::Document doc;
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode(text, val, doc);
+    }
+
+    // Same as decode, but a parse or decode error is returned instead of
+    // thrown, see DecodeResult
+    template <class T>
+    static DecodeResult try_decode(const std::string &data, T &val, JsonNumberMode mode = kJsonNumberDefault) {
+        rapidjson::Document doc;
+        DecodeResult result;
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode(data, val, doc, result);
+        return result;
+    }
+    template <class T>
+    static DecodeResult try_decode(JsonInsitu &text, T &val, JsonNumberMode mode = kJsonNumberDefault) {
+        rapidjson::Document doc;
+        DecodeResult result;
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode(text, val, doc, result);
+        return result;
+    }
 
+    #ifdef X_PACK_SUPPORT_CXX0X
+    // Same as decode, but the document and the parser stack live in arena,
+    // usually JsonArena::Local(), instead of being allocated for this call
+    template <class T>
+    static void decode(const std::string &data, T &val, JsonArena &arena, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonArena::Scope scope(arena);
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode(data, val, scope.Doc());
+    }
     template <class T>
-    static std::string encode(const T &val) {
+    static void decode(JsonInsitu &text, T &val, JsonArena &arena, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonArena::Scope scope(arena);
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode(text, val, scope.Doc());
+    }
+    template <class T>
+    static DecodeResult try_decode(const std::string &data, T &val, JsonArena &arena, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonArena::Scope scope(arena);
+        DecodeResult result;
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode(data, val, scope.Doc(), result);
+        return result;
+    }
+    template <class T>
+    static DecodeResult try_decode(JsonInsitu &text, T &val, JsonArena &arena, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonArena::Scope scope(arena);
+        DecodeResult result;
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode(text, val, scope.Doc(), result);
+        return result;
+    }
+    // Same as try_decode, but data is checked against schema while it is
+    // parsed, see JsonSchema. Nothing is decoded into val if data is not json
+    // or does not match the schema
+    template <class T>
+    static DecodeResult try_decode(const std::string &data, T &val, const JsonSchema &schema, JsonArena &arena) {
+        JsonArena::Scope scope(arena);
+        DecodeResult result;
+        if (schema.Parse(data.c_str(), scope.Doc(), scope.StackAllocator(), result)) {
+            JsonNode node(&scope.Doc());
+            XDecoder<JsonNode>(&result, node).decode(val, NULL);
+        }
+        return result;
+    }
+    // Same as decode, but large arrays are decoded on the threads of pool,
+    // see DecodePool
+    template <class T>
+    static void decode_parallel(const std::string &data, T &val, DecodePool &pool, JsonNumberMode mode = kJsonNumberDefault) {
+        DecodePool::Scope scope(&pool);
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode(data, val);
+    }
+    template <class T>
+    static void decode_parallel(const std::string &data, T &val, DecodePool &pool, JsonArena &arena, JsonNumberMode mode = kJsonNumberDefault) {
+        DecodePool::Scope scope(&pool);
+        decode(data, val, arena, mode);
+    }
+    template <class T>
+    static void decode_file(const std::string &file_name, T &val, JsonArena &arena, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonArena::Scope scope(arena);
+        JsonDecoder de;
+        de.SetNumberMode(mode);
+        de.decode_file(file_name, val, scope.Doc());
+    }
+
+    // Same as decode, but streams the tokens into val without building a
+    // rapidjson::Document. See JsonSaxDecoder.
+    template <class T>
+    static void decode_sax(const std::string &data, T &val, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonSaxDecoder de(data.data(), data.length());
+        de.SetNumberMode(mode);
+        de.decode_document(val);
+    }
+    template <class T>
+    static void decode_sax(const std::string &data, T &val, JsonArena &arena, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonArena::Scope scope(arena);
+        JsonSaxDecoder de(data.data(), data.length(), &scope.StackAllocator());
+        de.SetNumberMode(mode);
+        de.decode_document(val);
+    }
+    // A json object whose fields are decoded into T when they are read, see
+    // JsonLazy: json::lazy<T> req(data); req.Get(&T::member)
+    template <class T>
+    using lazy = JsonLazy<T>;
+
+    template <class T>
+    static void decode_file_sax(const std::string &file_name, T &val, JsonNumberMode mode = kJsonNumberDefault) {
+        FileMapping file;
+        if (!file.Map(file_name)) {
+            std::string data;
+            Util::readfile(file_name, data);
+            decode_sax(data, val, mode);
+            return;
+        }
+        file.AdviseSequential();
+        JsonSaxDecoder de(file.Data(), file.Size());
+        de.SetNumberMode(mode);
+        de.decode_document(val);
+    }
+    #endif
+
+    template <class T>
+    static std::string encode(const T &val, JsonNumberMode mode = kJsonNumberDefault) {
         JsonEncoder en;
+        en.SetNumberMode(mode);
         return en.encode(val);
     }
 
     template <class T>
-    static std::string encode(const T &val, int flag, int indentCount, char indentChar) {
+    static std::string encode(const T &val, int flag, int indentCount, char indentChar, JsonNumberMode mode = kJsonNumberDefault) {
         (void)flag;
         JsonEncoder en(indentCount, indentChar);
+        en.SetNumberMode(mode);
         return en.encode(val);
     }
+
+    // Same as encode, but writes into out, usually JsonBuffer::Local(), and
+    // reuses its memory. The result is out.Data()/out.Size().
+    template <class T>
+    static void encode(const T &val, JsonBuffer &out, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonEncoder en;
+        en.SetNumberMode(mode);
+        en.encode(val, out);
+    }
+    // Same as encode, but hands the text to sink in pieces of about chunk
+    // bytes while encoding, see JsonSink
+    template <class T>
+    static void encode(const T &val, JsonSink &sink, size_t chunk = JsonSink::kDefaultChunk, JsonNumberMode mode = kJsonNumberDefault) {
+        JsonEncoder en;
+        en.SetNumberMode(mode);
+        en.encode(val, sink, chunk);
+    }
+    template <class T>
+    static void encode_file(const T &val, const std::string &file_name, JsonNumberMode mode = kJsonNumberDefault) {
+        std::ofstream fs(file_name.c_str(), std::ofstream::binary);
+        if (!fs) {
+            std::string err = "Open file["+file_name+"] fail.";
+            throw std::runtime_error(err);
+        }
+        JsonOstreamSink sink(fs);
+        encode(val, sink, JsonSink::kDefaultChunk, mode);
+        fs.close();
+        if (!fs) {
+            std::string err = "Write file["+file_name+"] fail.";
+            throw std::runtime_error(err);
+        }
+    }
 };
 
 }
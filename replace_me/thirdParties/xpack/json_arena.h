@@ -0,0 +1,153 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_JSON_ARENA_H
+#define __X_PACK_JSON_ARENA_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "rapidjson_custom.h"
+#include "rapidjson/document.h"
+
+namespace xpack {
+
+/*
+  Memory kept by one thread between json decodes: a buffer for the parse tree
+  and one for the parser stack. A Scope runs a rapidjson::MemoryPoolAllocator
+  on each buffer. Chunks the pools need beyond their buffer are released when
+  the Scope ends, and the buffer grows to the size that was used (up to
+  kMaxRetained), so decoding documents of similar size stops allocating after
+  the first few calls.
+
+  An arena serves one decode at a time. A Scope taken while the arena is in
+  use (a decode nested in a custom codec, for example) gets a private arena.
+*/
+class JsonArena {
+public:
+    typedef rapidjson::MemoryPoolAllocator<> Allocator;
+    typedef rapidjson::GenericDocument<rapidjson::UTF8<>, Allocator, Allocator> Document;
+
+    static const size_t kInitialValues = 16*1024;
+    static const size_t kInitialStack = 4*1024;
+    static const size_t kMaxRetained = 4*1024*1024;
+
+    JsonArena():_busy(false), _values(kInitialValues), _stack(kInitialStack) {}
+
+    // arena of the calling thread
+    static JsonArena& Local() {
+        static thread_local JsonArena arena;
+        return arena;
+    }
+
+    // size of the buffers kept for the next decode
+    size_t Retained() const {
+        return _values.Size() + _stack.Size();
+    }
+
+    class Scope {
+    public:
+        explicit Scope(JsonArena &arena)
+            :_own(arena._busy ? new JsonArena : NULL),
+             _arena(Acquire(_own ? *_own : arena)),
+             _values(_arena._values.Data(), _arena._values.Size()),
+             _stack(_arena._stack.Data(), _arena._stack.Size()),
+             _doc(&_values, kDocStack, &_stack) {
+        }
+        ~Scope() {
+            // the buffers are still in use by the pools, they grow on the next Acquire
+            _arena._values.Fit(_values);
+            _arena._stack.Fit(_stack);
+            _arena._busy = false;
+        }
+
+        // empty document on the values pool
+        Document& Doc() {
+            return _doc;
+        }
+        // for a rapidjson::GenericReader stack
+        Allocator& StackAllocator() {
+            return _stack;
+        }
+
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+
+        static const size_t kDocStack = 1024; // rapidjson's default
+
+        static JsonArena& Acquire(JsonArena &arena) {
+            arena._busy = true;
+            arena._values.Grow();
+            arena._stack.Grow();
+            return arena;
+        }
+
+        std::unique_ptr<JsonArena> _own;
+        JsonArena &_arena;
+        Allocator _values;
+        Allocator _stack;
+        Document _doc;
+    };
+
+private:
+    JsonArena(const JsonArena&);
+    JsonArena& operator=(const JsonArena&);
+
+    class Buffer {
+    public:
+        explicit Buffer(size_t size):_want(size) {}
+
+        void *Data() {
+            return &_data[0];
+        }
+        size_t Size() const {
+            return _data.size()*sizeof(uint64_t);
+        }
+
+        // called when the pool on the buffer is done: if it had to allocate
+        // chunks, ask for a buffer that holds everything it used
+        void Fit(const Allocator &pool) {
+            if (pool.Capacity() <= Size()) {
+                return;
+            }
+            size_t want = Size();
+            while (want < pool.Size() + 1024 && want < kMaxRetained) {
+                want *= 2;
+            }
+            _want = want < kMaxRetained ? want : kMaxRetained;
+        }
+        void Grow() {
+            if (_want > Size()) {
+                std::vector<uint64_t>((_want+sizeof(uint64_t)-1)/sizeof(uint64_t)).swap(_data);
+            }
+        }
+
+    private:
+        std::vector<uint64_t> _data;
+        size_t _want;
+    };
+
+    bool _busy;
+    Buffer _values;
+    Buffer _stack;
+};
+
+}
+
+#endif
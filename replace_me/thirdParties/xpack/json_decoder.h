@@ -17,7 +17,10 @@
 #ifndef __X_PACK_JSON_DECODER_H
 #define __X_PACK_JSON_DECODER_H
 
+#include <string.h>
+
 #include <fstream>
+#include <vector>
 
 #include "rapidjson_custom.h"
 #include "rapidjson/document.h"
@@ -25,6 +28,9 @@
 
 #include "xdecoder.h"
 #include "json_data.h"
+#include "field_index.h"
+#include "file_mapping.h"
+#include "json_number.h"
 
 
 namespace xpack {
@@ -35,11 +41,12 @@ class JsonNode {
 public:
     typedef rapidjson::Value::ConstMemberIterator Iterator;
 
-    JsonNode(const rapidjson::Value* val=NULL):v(val){}
+    // insitu: the document was parsed in situ, so strings can be viewed
+    JsonNode(const rapidjson::Value* val=NULL, bool insitu=false):v(val),insitu(insitu){}
 
     // convert JsonData to JsonNode
     // The life cycle of jd cannot be shorter than JsonNode
-    JsonNode(const JsonData&jd):v(jd.current){}
+    JsonNode(const JsonData&jd):v(jd.current),insitu(false){}
 
     inline static const char * Name() {
         return "json";
@@ -56,10 +63,14 @@ public:
             return JsonNode();
         } else if (!v->IsObject()) {
             de.decode_exception("not object", NULL);
+            return JsonNode();
+        }
+        if (v->MemberCount() >= kIndexMembers) {
+            return JsonNode(this->FindIndexed(key), insitu);
         }
         rapidjson::Value::ConstMemberIterator iter = v->FindMember(key);
         if (iter != v->MemberEnd()) {
-            return JsonNode(&iter->value);
+            return JsonNode(&iter->value, insitu);
         } else {
             return JsonNode();
         }
@@ -69,15 +80,17 @@ public:
             return 0;
         } else if (!v->IsArray()) {
             de.decode_exception("not array", NULL);
+            return 0;
         }
         return (size_t)v->Size();
     }
     JsonNode At(size_t index) const { // no exception
-        return JsonNode(&(*v)[(rapidjson::SizeType)index]);
+        return JsonNode(&(*v)[(rapidjson::SizeType)index], insitu);
     }
     JsonNode Next(decoder&de, const JsonNode&parent, Iterator&iter, std::string&key) const {
         if (!parent.v->IsObject()) {
             de.decode_exception("not object", NULL);
+            return JsonNode();
         }
 
         if (v != parent.v) {
@@ -88,7 +101,7 @@ public:
 
         if (iter != parent.v->MemberEnd()) {
             key = iter->name.GetString();
-            return JsonNode(&iter->value);
+            return JsonNode(&iter->value, insitu);
         }
 
         return JsonNode();
@@ -103,6 +116,22 @@ public:
         }
         return true;
     }
+    #ifdef X_PACK_SUPPORT_CXX17
+    bool Get(decoder&de, std::string_view&val, const Extend*ext) {
+        (void)ext;
+        if (!insitu) {
+            // the string would be freed with the document
+            de.decode_exception("string view needs an in-situ decode", NULL);
+            return false;
+        }
+        if (v->IsString()) {
+            val = std::string_view(v->GetString(), v->GetStringLength());
+        } else if (!v->IsNull()) {
+            de.decode_exception("not string", NULL);
+        }
+        return true;
+    }
+    #endif
     bool Get(decoder&de, bool &val, const Extend*ext) {
         (void)ext;
         if (v->IsBool()) {
@@ -155,50 +184,293 @@ public:
     }
 
 private:
+    typedef rapidjson::Value::Member Member;
+
+    // Objects with this many members get a hash table on the first Find, so
+    // decoding a struct reads every member once instead of once per field.
+    static const rapidjson::SizeType kIndexMembers = 16;
+
+    static bool SameName(const Member *m, const char *key, size_t length) {
+        return m->name.GetStringLength() == length && 0 == memcmp(m->name.GetString(), key, length);
+    }
+
+    const rapidjson::Value* FindIndexed(const char *key) const {
+        if (members.empty()) {
+            size_t size = 4;
+            while (size < (size_t)v->MemberCount()*2) {
+                size *= 2;
+            }
+            members.resize(size, (const Member*)NULL);
+            for (Iterator it=v->MemberBegin(); it!=v->MemberEnd(); ++it) {
+                const char *name = it->name.GetString();
+                size_t length = it->name.GetStringLength();
+                size_t i = FieldIndex::Hash(name, length)&(size-1);
+                while (members[i] != NULL && !SameName(members[i], name, length)) {
+                    i = (i+1)&(size-1);
+                }
+                if (members[i] == NULL) { // first member wins, like FindMember
+                    members[i] = &*it;
+                }
+            }
+        }
+
+        size_t length = strlen(key);
+        size_t mask = members.size()-1;
+        for (size_t i=FieldIndex::Hash(key, length)&mask; members[i]!=NULL; i=(i+1)&mask) {
+            if (SameName(members[i], key, length)) {
+                return &members[i]->value;
+            }
+        }
+        return NULL;
+    }
+
     const rapidjson::Value* v;
+    bool insitu;
     rapidjson::Value::ConstMemberIterator iter;
+    mutable std::vector<const Member*> members;
+};
+
+/*
+  Text for an in-situ decode (rapidjson::kParseInsituFlag). Strings are
+  unescaped inside the text instead of being copied into the document, so
+  std::string_view and std::span<const char> members of the decoded structure
+  point into it and stay valid as long as the JsonInsitu lives.
+  The decode modifies the text, so it can be decoded only once.
+*/
+class JsonInsitu : private noncopyable {
+public:
+    // copy of text
+    explicit JsonInsitu(const std::string &text):_own(text), _length(text.length()), _used(false) {
+        _text = &_own[0];
+    }
+    #ifdef X_PACK_SUPPORT_CXX0X
+    explicit JsonInsitu(std::string &&text):_own(std::move(text)), _length(_own.length()), _used(false) {
+        _text = &_own[0];
+    }
+    #endif
+    // text owned by the caller, text[length] must be '\0'
+    JsonInsitu(char *text, size_t length):_text(text), _length(length), _used(false) {
+        if (text[length] != '\0') {
+            throw std::runtime_error("in-situ json text must be NUL terminated");
+        }
+    }
+
+    char *Take(size_t &length) {
+        if (_used) {
+            throw std::runtime_error("in-situ json text has been decoded already");
+        }
+        _used = true;
+        length = _length;
+        return _text;
+    }
+
+private:
+    std::string _own;
+    char *_text;
+    size_t _length;
+    bool _used;
 };
 
 class JsonDecoder {
 public:
+    JsonDecoder():_numberMode(kJsonNumberDefault) {}
+
+    // see JsonNumberMode
+    void SetNumberMode(JsonNumberMode mode) {
+        _numberMode = mode;
+    }
+
     template <class T>
     bool decode(const std::string&str, T&val) {
         rapidjson::Document doc;
-        if (this->parse(str, doc)) {
-            JsonNode node(&doc);
-            return XDecoder<JsonNode>(NULL, (const char*)NULL, node).decode(val, NULL);
-        }
-        return false;
+        return this->decode(str, val, doc);
+    }
+    // parse into doc, which must use the default value allocator
+    // (rapidjson::MemoryPoolAllocator<>) so that it is a rapidjson::Value
+    template <class T, class Document>
+    bool decode(const std::string&str, T&val, Document &doc) {
+        return this->decode_text(str, val, doc, NULL);
+    }
+    // text is parsed in place, see JsonInsitu
+    template <class T, class Document>
+    bool decode(JsonInsitu&text, T&val, Document &doc) {
+        return this->decode_insitu(text, val, doc, NULL);
+    }
+    // Same as above, but errors are recorded in result instead of thrown,
+    // see DecodeResult. Returns result.Ok()
+    template <class T, class Document>
+    bool decode(const std::string&str, T&val, Document &doc, DecodeResult &result) {
+        return this->decode_text(str, val, doc, &result);
+    }
+    template <class T, class Document>
+    bool decode(JsonInsitu&text, T&val, Document &doc, DecodeResult &result) {
+        return this->decode_insitu(text, val, doc, &result);
     }
     template <class T>
     bool decode_file(const std::string&fname, T&val) {
-        std::string data;
-        bool ret = Util::readfile(fname, data);
-        if (ret) {
-            ret =  this->decode(data, val);
+        rapidjson::Document doc;
+        return this->decode_file(fname, val, doc);
+    }
+    // parses straight from a read-only mapping of the file, see FileMapping
+    template <class T, class Document>
+    bool decode_file(const std::string&fname, T&val, Document &doc) {
+        FileMapping file;
+        if (!file.Map(fname)) {
+            std::string data;
+            Util::readfile(fname, data);
+            return this->decode(data, val, doc);
         }
-        return ret;
+        file.AdviseSequential();
+        if (this->parse(file.Data(), file.Size(), file.Terminated(), doc, NULL)) {
+            return this->decode_doc(doc, val, false, NULL);
+        }
+        return false;
     }
 private:
-    bool parse(const std::string&data, rapidjson::Document &doc) {
-        std::string err;
+    template <class T, class Document>
+    bool decode_text(const std::string&str, T&val, Document &doc, DecodeResult *result) {
+        if (this->parse(str.c_str(), str.length(), true, doc, result)) {
+            return this->decode_doc(doc, val, false, result);
+        }
+        return false;
+    }
+    template <class T, class Document>
+    bool decode_insitu(JsonInsitu&text, T&val, Document &doc, DecodeResult *result) {
+        size_t length = 0;
+        char *data = text.Take(length);
+        const unsigned int parseFlags = rapidjson::kParseInsituFlag|rapidjson::kParseNanAndInfFlag;
+        rapidjson::ParseResult err;
+        if (_numberMode == kJsonNumberExact) {
+            #ifdef X_PACK_SUPPORT_CHARCONV
+            rapidjson::InsituStringStream is(data);
+            err = this->parse_exact<parseFlags>(is, doc);
+            #else
+            err = doc.template ParseInsitu<parseFlags|rapidjson::kParseFullPrecisionFlag>(data);
+            #endif
+        } else {
+            err = doc.template ParseInsitu<parseFlags>(data);
+        }
+        if (err.IsError()) {
+            this->parse_exception(err, data, length, result);
+            return false;
+        }
+        return this->decode_doc(doc, val, true, result);
+    }
+    template <class T, class Document>
+    bool decode_doc(Document &doc, T&val, bool insitu, DecodeResult *result) {
+        JsonNode node(&doc, insitu);
+        if (NULL == result) {
+            return XDecoder<JsonNode>(NULL, (const char*)NULL, node).decode(val, NULL);
+        }
+        XDecoder<JsonNode>(result, node).decode(val, NULL);
+        return result->Ok();
+    }
 
+    template <class Document>
+    bool parse(const char *text, size_t length, bool terminated, Document &doc, DecodeResult *result) {
         const unsigned int parseFlags = rapidjson::kParseNanAndInfFlag;
-        doc.Parse<parseFlags>(data.data(), data.length());
+        if (_numberMode == kJsonNumberExact) {
+            #ifdef X_PACK_SUPPORT_CHARCONV
+            return this->parse<parseFlags, true>(text, length, terminated, doc, result);
+            #else
+            return this->parse<parseFlags|rapidjson::kParseFullPrecisionFlag, false>(text, length, terminated, doc, result);
+            #endif
+        }
+        return this->parse<parseFlags, false>(text, length, terminated, doc, result);
+    }
+    template <unsigned int parseFlags, bool exact, class Document>
+    bool parse(const char *text, size_t length, bool terminated, Document &doc, DecodeResult *result) {
+        rapidjson::ParseResult err;
+        if (terminated) {
+            // rapidjson only scans strings with SIMD in NUL terminated text.
+            // An embedded NUL still ends the document as it does with a
+            // length, but the UTF-8 BOM is not skipped for us
+            if (length >= 3 && 0 == memcmp(text, "\xEF\xBB\xBF", 3)) {
+                text += 3;
+                length -= 3;
+            }
+            if (exact) {
+                rapidjson::StringStream is(text);
+                err = this->parse_exact<parseFlags>(is, doc);
+            } else {
+                err = doc.template Parse<parseFlags>(text);
+            }
+        } else if (exact) {
+            if (length >= 3 && 0 == memcmp(text, "\xEF\xBB\xBF", 3)) {
+                text += 3;
+                length -= 3;
+            }
+            rapidjson::MemoryStream is(text, length);
+            err = this->parse_exact<parseFlags>(is, doc);
+        } else {
+            err = doc.template Parse<parseFlags>(text, length);
+        }
 
-        if (doc.HasParseError()) {
-            size_t offset = doc.GetErrorOffset();
-            std::string parse_err(rapidjson::GetParseError_En(doc.GetParseError()));
-            std::string err_data = data.substr(offset, 32);
-            err = "Parse json fail. err="+parse_err+". offset="+err_data;
-            throw std::runtime_error(err);
+        if (err.IsError()) {
+            this->parse_exception(err, text, length, result);
+            return false;
         }
         return true;
     }
+
+    #ifdef X_PACK_SUPPORT_CHARCONV
+    // fills doc through JsonExactHandler, see kJsonNumberExact
+    template <unsigned int parseFlags, class Stream>
+    class ExactGenerator {
+    public:
+        explicit ExactGenerator(Stream &is):_is(is) {}
+
+        template <class Handler>
+        bool operator()(Handler &h) {
+            rapidjson::Reader reader;
+            JsonExactHandler<Handler, Stream> exact(h, _is);
+            result = reader.template Parse<parseFlags>(_is, exact);
+            return !result.IsError();
+        }
+
+        rapidjson::ParseResult result;
+    private:
+        Stream &_is;
+    };
+    template <unsigned int parseFlags, class Stream, class Document>
+    rapidjson::ParseResult parse_exact(Stream &is, Document &doc) {
+        ExactGenerator<parseFlags, Stream> g(is);
+        doc.Populate(g);
+        return g.result;
+    }
+    #else
+    template <unsigned int parseFlags, class Stream, class Document>
+    rapidjson::ParseResult parse_exact(Stream &is, Document &doc) {
+        (void)is; (void)doc;
+        return rapidjson::ParseResult();
+    }
+    #endif
+
+    // throws, or records the error in result if there is one
+    void parse_exception(const rapidjson::ParseResult &pr, const char *data, size_t length, DecodeResult *result) {
+        size_t offset = pr.Offset();
+        std::string parse_err(rapidjson::GetParseError_En(pr.Code()));
+        std::string err_data;
+        if (offset < length) {
+            err_data.assign(data+offset, length-offset < 32 ? length-offset : 32);
+        }
+        std::string err = "Parse json fail. err="+parse_err+". offset="+err_data;
+        if (NULL != result) {
+            result->Fail(err, std::string(), offset);
+            return;
+        }
+        throw std::runtime_error(err);
+    }
+
+    JsonNumberMode _numberMode;
 };
 
 // /////////////// JsonData ///////////////////
 template<>struct is_xpack_type_spec<JsonNode, JsonData> {static bool const value = true;};
+#ifdef X_PACK_SUPPORT_CXX0X
+// read only access to a rapidjson::Document, each thread has its own nodes
+template<>struct is_parallel_node<JsonNode> {static bool const value = true;};
+#endif
 
 template <typename T>
 inline T JsonData::Get() const {
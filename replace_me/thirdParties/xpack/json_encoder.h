@@ -17,7 +17,14 @@
 #ifndef __X_PACK_JSON_ENCODER_H
 #define __X_PACK_JSON_ENCODER_H
 
+#include <string.h>
+
+#include <ostream>
+#include <stdexcept>
 #include <string>
+#ifdef X_PACK_SUPPORT_CXX0X
+#include <atomic>
+#endif
 
 #include "rapidjson_custom.h"
 #include "rapidjson/prettywriter.h"
@@ -25,52 +32,194 @@
 
 #include "xencoder.h"
 #include "json_data.h"
+#include "json_number.h"
 
 namespace xpack {
 
-class JsonWriter:private noncopyable {
+// rapidjson::Writer that also writes keys that are quoted already
+class JsonKeyWriter:public rapidjson::Writer<rapidjson::StringBuffer> {
+public:
+    explicit JsonKeyWriter(rapidjson::StringBuffer &os):rapidjson::Writer<rapidjson::StringBuffer>(os) {}
+
+    void RawKey(const char *quoted, size_t length) {
+        this->Prefix(rapidjson::kStringType);
+        memcpy(this->os_->Push(length), quoted, length);
+    }
+};
+
+/*
+  Output of a json encode that can be reused. The text and the writer stacks
+  keep their capacity from one encode to the next, so a buffer reused for
+  similar values stops allocating. Data() is valid until the next encode.
+*/
+class JsonBuffer:private noncopyable {
     typedef rapidjson::StringBuffer JSON_WRITER_BUFFER;
-    typedef rapidjson::Writer<rapidjson::StringBuffer> JSON_WRITER_WRITER;
+    typedef JsonKeyWriter JSON_WRITER_WRITER;
     typedef rapidjson::PrettyWriter<rapidjson::StringBuffer> JSON_WRITER_PRETTY;
 
+    friend class JsonWriter;
+public:
+    JsonBuffer():_writer(_text), _pretty(_text) {}
+
+    #ifdef X_PACK_SUPPORT_CXX0X
+    // buffer of the calling thread
+    static JsonBuffer& Local() {
+        static thread_local JsonBuffer buffer;
+        return buffer;
+    }
+    #endif
+
+    const char *Data() const {
+        return _text.GetString();
+    }
+    size_t Size() const {
+        return _text.GetSize();
+    }
+    std::string String() const {
+        return std::string(_text.GetString(), _text.GetSize());
+    }
+
+private:
+    JSON_WRITER_BUFFER _text;
+    JSON_WRITER_WRITER _writer;
+    JSON_WRITER_PRETTY _pretty;
+};
+
+/*
+  Receiver of json encoded in pieces, so that a large value is never held in
+  memory as a whole. Write is called each time the pending text reaches the
+  chunk size, and once more with the rest. A piece may end anywhere, inside a
+  string or a UTF-8 sequence too. Write throws to abort the encode.
+*/
+class JsonSink {
+public:
+    static const size_t kDefaultChunk = 64*1024;
+
+    virtual ~JsonSink() {}
+    virtual void Write(const char *data, size_t size) = 0;
+};
+
+// writes to a std::ostream, a std::ofstream for a file
+class JsonOstreamSink:public JsonSink {
+public:
+    explicit JsonOstreamSink(std::ostream &os):_os(os) {}
+
+    virtual void Write(const char *data, size_t size) {
+        _os.write(data, (std::streamsize)size);
+        if (!_os) {
+            throw std::runtime_error("Write json stream fail.");
+        }
+    }
+
+private:
+    std::ostream &_os;
+};
+
+/*
+  Size of the json recently encoded for T. The next encode of a T reserves it
+  up front instead of growing the output step by step.
+*/
+template <class T>
+class JsonSizeHint {
+public:
+    static size_t Get() {
+        #ifdef X_PACK_SUPPORT_CXX0X
+        return Value().load(std::memory_order_relaxed);
+        #else
+        return Value();
+        #endif
+    }
+    // follows growth at once and shrinks slowly
+    static void Update(size_t size) {
+        size_t old = Get();
+        size_t hint = size >= old ? size : old-(old-size)/4;
+        #ifdef X_PACK_SUPPORT_CXX0X
+        Value().store(hint, std::memory_order_relaxed);
+        #else
+        Value() = hint;
+        #endif
+    }
+
+private:
+    #ifdef X_PACK_SUPPORT_CXX0X
+    static std::atomic<size_t>& Value() {
+        static std::atomic<size_t> value(0);
+        return value;
+    }
+    #else
+    static size_t& Value() {
+        static size_t value = 0;
+        return value;
+    }
+    #endif
+};
+
+class JsonWriter:private noncopyable {
+    typedef JsonBuffer::JSON_WRITER_WRITER JSON_WRITER_WRITER;
+    typedef JsonBuffer::JSON_WRITER_PRETTY JSON_WRITER_PRETTY;
+
     friend class XEncoder<JsonWriter>;
     friend class JsonEncoder;
 
     const static bool support_null = true;
 public:
-    JsonWriter(int indentCount = -1, char indentChar = ' ', int maxDecimalPlaces = -1) {
-        _buf = new JSON_WRITER_BUFFER;
+    JsonWriter(int indentCount = -1, char indentChar = ' ', int maxDecimalPlaces = -1):_out(_own), _sink(NULL), _chunk(0) {
+        this->init(indentCount, indentChar, maxDecimalPlaces);
+    }
+    // writes into out, which is cleared first
+    JsonWriter(JsonBuffer &out, int indentCount = -1, char indentChar = ' ', int maxDecimalPlaces = -1):_out(out), _sink(NULL), _chunk(0) {
+        this->init(indentCount, indentChar, maxDecimalPlaces);
+    }
+    // hands the text to sink every chunk bytes, Flush() sends the rest
+    JsonWriter(JsonSink &sink, size_t chunk, int indentCount = -1, char indentChar = ' ', int maxDecimalPlaces = -1):_out(_own), _sink(&sink), _chunk(chunk) {
+        this->init(indentCount, indentChar, maxDecimalPlaces);
+        this->Reserve(chunk);
+    }
+
+    void Flush() {
+        if (NULL != _sink && _out.Size() > 0) {
+            _sink->Write(_out.Data(), _out.Size());
+            _out._text.Clear(); // the rapidjson writers never read back their output
+        }
+    }
+
+private:
+    void init(int indentCount, char indentChar, int maxDecimalPlaces) {
+        _out._text.Clear();
+        _shortest = false;
+        _fixedDecimals = maxDecimalPlaces > 0;
+        if (maxDecimalPlaces <= 0) {
+            maxDecimalPlaces = JSON_WRITER_WRITER::kDefaultMaxDecimalPlaces;
+        }
         if (indentCount < 0) {
-            _writer = new JSON_WRITER_WRITER(*_buf);
-            if (maxDecimalPlaces > 0) {
-                _writer->SetMaxDecimalPlaces(maxDecimalPlaces);
-            }
+            _writer = &_out._writer;
+            _writer->Reset(_out._text);
+            _writer->SetMaxDecimalPlaces(maxDecimalPlaces);
             _pretty = NULL;
         } else {
-            _pretty = new JSON_WRITER_PRETTY(*_buf);
+            _pretty = &_out._pretty;
+            _pretty->Reset(_out._text);
             _pretty->SetIndent(indentChar, indentCount);
-            if (maxDecimalPlaces > 0) {
-                _pretty->SetMaxDecimalPlaces(maxDecimalPlaces);
-            }
+            _pretty->SetFormatOptions(rapidjson::kFormatDefault);
+            _pretty->SetMaxDecimalPlaces(maxDecimalPlaces);
             _writer = NULL;
         }
     }
-    ~JsonWriter() {
-        if (NULL != _buf) {
-            delete _buf;
-            _buf = NULL;
-        }
-        if (NULL != _writer) {
-            delete _writer;
-            _writer = NULL;
-        }
-        if (NULL != _pretty) {
-            delete _pretty;
-            _pretty = NULL;
-        }
+    // maxDecimalPlaces needs rapidjson's formatting, so it wins over kJsonNumberExact
+    void NumberMode(JsonNumberMode mode) {
+        #ifdef X_PACK_SUPPORT_CHARCONV
+        _shortest = mode == kJsonNumberExact && !_fixedDecimals;
+        #else
+        (void)mode;
+        #endif
+    }
+    void Reserve(size_t size) {
+        _out._text.Reserve(size);
+    }
+    size_t Size() const {
+        return _out.Size();
     }
 
-private:
     inline static const char *Name() {
         return "json";
     }
@@ -79,7 +228,7 @@ private:
         return NULL;
     }
     std::string String() {
-        return _buf->GetString();
+        return _out.String();
     }
 
     void ArrayBegin(const char *key, const Extend *ext) {
@@ -183,6 +332,18 @@ private:
     typename x_enable_if<numeric<T>::is_float, bool>::type encode_number(const char*key, const T&val, const Extend *ext) {
         (void)ext;
         xpack_set_key(key);
+        #ifdef X_PACK_SUPPORT_CHARCONV
+        char buf[JsonNumber::kMaxChars];
+        size_t length;
+        if (_shortest && JsonNumber::Shortest(val, buf, length)) {
+            if (NULL != _writer) {
+                _writer->RawValue(buf, length, rapidjson::kNumberType);
+            } else {
+                _pretty->RawValue(buf, length, rapidjson::kNumberType);
+            }
+            return true;
+        }
+        #endif
         if (NULL != _writer) {
             _writer->Double((double)val);
         } else {
@@ -234,7 +395,23 @@ private:
         return true;
     }
 
+    // quoted key that needs no escaping, see XEncoder::encode_field
+    void RawKey(const char *quoted, size_t length) {
+        if (NULL != _sink && _out.Size() >= _chunk) {
+            this->Flush();
+        }
+        if (NULL != _writer) {
+            _writer->RawKey(quoted, length);
+        } else {
+            _pretty->RawValue(quoted, length, rapidjson::kStringType);
+        }
+    }
+
     void xpack_set_key(const char*key) { // openssl defined set_key macro, so we named it xpack_set_key
+        // every value starts here, so a streamed output is cut between values
+        if (NULL != _sink && _out.Size() >= _chunk) {
+            this->Flush();
+        }
         if (NULL!=key && key[0]!='\0') {
             if (NULL != _writer) {
                 _writer->Key(key);
@@ -244,40 +421,77 @@ private:
         }
     }
 
-    JSON_WRITER_BUFFER* _buf;
+    JsonBuffer _own;
+    JsonBuffer &_out;
+    JsonSink *_sink;
+    size_t _chunk;
+    bool _shortest;
+    bool _fixedDecimals;
     JSON_WRITER_WRITER* _writer;
     JSON_WRITER_PRETTY* _pretty;
 };
 
+template<>struct is_xpack_raw_key<JsonWriter> {static bool const value = true;};
+
 class JsonEncoder {
 public:
     JsonEncoder() {
         indentCount = -1;
         indentChar = ' ';
         maxDecimalPlaces = -1;
+        numberMode = kJsonNumberDefault;
     }
     JsonEncoder(int _indentCount, char _indentChar, int _maxDecimalPlaces = -1) { // compat
         indentCount = _indentCount;
         indentChar = _indentChar;
         maxDecimalPlaces = _maxDecimalPlaces;
+        numberMode = kJsonNumberDefault;
     }
 
     void SetMaxDecimalPlaces(int _maxDecimalPlaces) {
         maxDecimalPlaces = _maxDecimalPlaces;
     }
+    // see JsonNumberMode
+    void SetNumberMode(JsonNumberMode _numberMode) {
+        numberMode = _numberMode;
+    }
 
     template <class T>
     std::string encode(const T&val) {
         JsonWriter wr(indentCount, indentChar, maxDecimalPlaces);
+        this->write(val, wr);
+        return wr.String();
+    }
+    // into out, see JsonBuffer
+    template <class T>
+    void encode(const T&val, JsonBuffer &out) {
+        JsonWriter wr(out, indentCount, indentChar, maxDecimalPlaces);
+        this->write(val, wr);
+    }
+    // to sink, in pieces of about chunk bytes, see JsonSink
+    template <class T>
+    void encode(const T&val, JsonSink &sink, size_t chunk = JsonSink::kDefaultChunk) {
+        JsonWriter wr(sink, chunk, indentCount, indentChar, maxDecimalPlaces);
+        wr.NumberMode(numberMode);
         XEncoder<JsonWriter> en(wr);
         en.encode(NULL, val, NULL);
-        return wr.String();
+        wr.Flush();
     }
 
 private:
+    template <class T>
+    void write(const T&val, JsonWriter &wr) {
+        wr.NumberMode(numberMode);
+        wr.Reserve(JsonSizeHint<T>::Get());
+        XEncoder<JsonWriter> en(wr);
+        en.encode(NULL, val, NULL);
+        JsonSizeHint<T>::Update(wr.Size());
+    }
+
     int indentCount;
     char indentChar;
     int maxDecimalPlaces;
+    JsonNumberMode numberMode;
 };
 
 // //////////////// JsonData  ///////////////////////
@@ -0,0 +1,344 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_JSON_LAZY_H
+#define __X_PACK_JSON_LAZY_H
+
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rapidjson_custom.h"
+#include "rapidjson/document.h"
+#include "rapidjson/error/en.h"
+
+#include "xdecoder.h"
+#include "json_decoder.h"
+
+namespace xpack {
+
+/*
+  A json object decoded into T one field at a time, on first access.
+
+  The constructor scans the text once for the structure of the top level
+  object: where the value of each member starts and ends. Nested values are
+  skipped over by their brackets and quotes without being parsed, so the scan
+  costs far less than a decode and allocates only the member table. Get
+  parses the text of one member and decodes it into its field with the
+  field's flags; the other fields are left alone, and Raw hands out the text
+  of a member to pass it on without decoding it.
+
+  The scan checks the top level object only, an error inside a member value
+  is found (and thrown, as by json::decode) when that member is decoded.
+  Duplicate keys resolve to the first member, like JsonDecoder.
+
+  Fields are recognized by address, so Get takes a pointer to a data member
+  of T (or of an XPACK base of T). Bitfields cannot be read through Get, use
+  Value. Fields of a C() custom codec are decoded by the codec through a
+  value of its own, so Get never finds them by address; Get of such a field
+  falls back to Value, and costs a full decode.
+*/
+template <class T>
+class JsonLazy {
+public:
+    explicit JsonLazy(std::string data):_text(std::move(data)), _complete(false) {
+        this->index();
+    }
+
+    // the field, decoded from its member the first time it is asked for
+    template <class M, class C>
+    const M& Get(M C::*member) {
+        M &val = static_cast<C&>(_val).*member;
+        if (!_complete && !this->decoded(&val)) {
+            Dispatch d(*this, &val);
+            d.decode_struct(_val, NULL);
+            if (!d.reached) {
+                this->Value(); // C() field, see the class comment
+                return val;
+            }
+            _decoded.push_back(&val);
+        }
+        return val;
+    }
+
+    // every field, decoding those that have not been read yet
+    const T& Value() {
+        if (!_complete) {
+            Dispatch d(*this, NULL);
+            d.decode_struct(_val, NULL);
+            _complete = true;
+            _decoded.clear();
+        }
+        return _val;
+    }
+
+    // text of the member named key, false if the object does not have it
+    bool Raw(const char *key, const char *&data, size_t &length) const {
+        const Member *m = this->find(key);
+        if (NULL == m) {
+            return false;
+        }
+        data = _text.data()+m->begin;
+        length = m->length;
+        return true;
+    }
+
+    // true if the object has a member named key
+    bool Has(const char *key) const {
+        return NULL != this->find(key);
+    }
+
+private:
+    JsonLazy(const JsonLazy&);
+    JsonLazy& operator=(const JsonLazy&);
+
+    static const unsigned kParseFlags = rapidjson::kParseNanAndInfFlag;
+
+    struct Member {
+        std::string key;
+        size_t begin;       // value in _text
+        size_t length;
+    };
+
+    // Runs __x_pack_decode of T and decodes the field at target, or with a
+    // NULL target every field that has not been decoded.
+    class Dispatch {
+    public:
+        Dispatch(JsonLazy &l, const void *t):reached(false), lazy(l), target(t) {}
+
+        template <class M>
+        bool decode(const char *key, M &val, const Extend *ext) {
+            if (NULL != target ? (const void*)&val != target : lazy.decoded(&val)) {
+                return false;
+            }
+            reached = true;
+            const Member *m = lazy.find(key);
+            if (NULL == m) {
+                if (Extend::Mandatory(ext)) {
+                    this->decode_exception("mandatory key not found", key);
+                }
+                return false;
+            }
+
+            rapidjson::Document doc;
+            doc.Parse<kParseFlags>(lazy._text.data()+m->begin, m->length);
+            if (doc.HasParseError()) {
+                lazy.parse_exception(rapidjson::GetParseError_En(doc.GetParseError()), m->begin+doc.GetErrorOffset());
+            }
+            JsonNode node(&doc);
+            return XDecoder<JsonNode>(NULL, key, node).decode(val, ext);
+        }
+        // inherited XPACK struct
+        template <class M>
+        bool decode(M &val, const Extend *ext) {
+            if (0 != (X_PACK_CTRL_FLAG_INHERIT&Extend::CtrlFlag(ext))) {
+                return this->decode_struct(val, ext);
+            }
+            return false;
+        }
+
+        template <class M>
+        inline XPACK_IS_XPACK(M) decode_struct(M &val, const Extend *ext) {
+            return val.__x_pack_decode(*this, val, ext);
+        }
+        template <class M>
+        inline XPACK_IS_XOUT(M) decode_struct(M &val, const Extend *ext) {
+            return __x_pack_decode_out(*this, val, ext);
+        }
+
+        inline static const char *Name() {
+            return "json";
+        }
+        void decode_exception(const char *what, const char *key) const {
+            std::string err;
+            if (NULL != what) {
+                err.append(what);
+            }
+            err.append(". (path:");
+            if (NULL != key) {
+                err.append(key);
+            }
+            err.append(")");
+            throw std::runtime_error(err);
+        }
+
+        bool reached;   // the target field was decoded under its address
+    private:
+        JsonLazy &lazy;
+        const void *target;
+    };
+
+    bool decoded(const void *field) const {
+        return std::find(_decoded.begin(), _decoded.end(), field) != _decoded.end();
+    }
+
+    const Member* find(const char *key) const {
+        size_t length = strlen(key);
+        for (size_t i=0; i<_members.size(); ++i) {
+            const std::string &k = _members[i].key;
+            if (k.length() == length && 0 == memcmp(k.data(), key, length)) {
+                return &_members[i];
+            }
+        }
+        return NULL;
+    }
+
+    ///////////////////// scan //////////////////////
+    void index() {
+        const char *begin = _text.c_str();
+        const char *end = begin+_text.length();
+        const char *p = begin;
+        if (_text.length() >= 3 && 0 == memcmp(p, "\xEF\xBB\xBF", 3)) {
+            p += 3;
+        }
+
+        p = Space(p, end);
+        if (p == end || *p != '{') {
+            this->parse_exception("not object", (size_t)(p-begin));
+        }
+        p = Space(p+1, end);
+        if (p < end && *p == '}') {
+            p = Space(p+1, end);
+        } else {
+            while (true) {
+                const char *key = p;
+                if (p == end || *p != '"' || NULL == (p = String(p, end))) {
+                    this->parse_exception("Missing a name for object member.", (size_t)(key-begin));
+                }
+                Member m;
+                this->key(key, p, m.key);
+
+                p = Space(p, end);
+                if (p == end || *p != ':') {
+                    this->parse_exception("Missing a colon after a name of object member.", (size_t)(p-begin));
+                }
+                p = Space(p+1, end);
+                const char *value = p;
+                if (NULL == (p = Value(p, end))) {
+                    this->parse_exception("Invalid value.", (size_t)(value-begin));
+                }
+                m.begin = (size_t)(value-begin);
+                m.length = (size_t)(p-value);
+                _members.push_back(m);
+
+                p = Space(p, end);
+                if (p < end && *p == ',') {
+                    p = Space(p+1, end);
+                } else if (p < end && *p == '}') {
+                    p = Space(p+1, end);
+                    break;
+                } else {
+                    this->parse_exception("Missing a comma or '}' after an object member.", (size_t)(p-begin));
+                }
+            }
+        }
+        if (p != end) {
+            this->parse_exception("The document root must not be followed by other values.", (size_t)(p-begin));
+        }
+    }
+
+    // name of the member from its quoted text [b, e)
+    void key(const char *b, const char *e, std::string &name) const {
+        if (NULL == memchr(b, '\\', (size_t)(e-b))) {
+            name.assign(b+1, (size_t)(e-b-2));
+            return;
+        }
+        rapidjson::Document doc;
+        doc.Parse<kParseFlags>(b, (size_t)(e-b));
+        if (doc.HasParseError()) {
+            this->parse_exception(rapidjson::GetParseError_En(doc.GetParseError()), (size_t)(b-_text.c_str())+doc.GetErrorOffset());
+        }
+        name.assign(doc.GetString(), doc.GetStringLength());
+    }
+
+    static const char* Space(const char *p, const char *end) {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            ++p;
+        }
+        return p;
+    }
+    // end of the string starting at the quote at p, NULL if it is not closed
+    static const char* String(const char *p, const char *end) {
+        for (++p; p < end; ++p) {
+            p = (const char*)memchr(p, '"', (size_t)(end-p));
+            if (NULL == p) {
+                return NULL;
+            }
+            const char *q = p;
+            while (*(q-1) == '\\') {
+                --q;
+            }
+            if ((p-q)%2 == 0) { // not escaped
+                return p+1;
+            }
+        }
+        return NULL;
+    }
+    // end of the value starting at p, NULL if the text ends first
+    static const char* Value(const char *p, const char *end) {
+        if (p == end) {
+            return NULL;
+        } else if (*p == '"') {
+            return String(p, end);
+        } else if (*p == '{' || *p == '[') {
+            size_t depth = 0;
+            for (; p < end; ++p) {
+                if (*p == '"') {
+                    p = String(p, end);
+                    if (NULL == p) {
+                        return NULL;
+                    }
+                    --p;
+                } else if (*p == '{' || *p == '[') {
+                    ++depth;
+                } else if (*p == '}' || *p == ']') {
+                    if (--depth == 0) {
+                        return p+1;
+                    }
+                }
+            }
+            return NULL;
+        }
+        // number, true, false, null
+        const char *b = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') {
+            ++p;
+        }
+        return p != b ? p : NULL;
+    }
+
+    void parse_exception(const char *what, size_t offset) const {
+        std::string err_data;
+        if (offset < _text.length()) {
+            err_data.assign(_text, offset, 32);
+        }
+        throw std::runtime_error(std::string("Parse json fail. err=")+what+". offset="+err_data);
+    }
+
+    std::string _text;
+    std::vector<Member> _members;
+    T _val;
+    std::vector<const void*> _decoded;     // fields read by Get
+    bool _complete;                         // Value has decoded every field
+};
+
+}
+
+#endif
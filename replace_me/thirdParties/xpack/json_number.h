@@ -0,0 +1,157 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_JSON_NUMBER_H
+#define __X_PACK_JSON_NUMBER_H
+
+#include <stddef.h>
+
+#include "traits.h"
+
+#ifdef X_PACK_SUPPORT_CHARCONV
+#include <charconv>
+#include <cmath>
+
+#include "rapidjson_custom.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/memorystream.h"
+
+namespace rapidjson {
+// Copied into a local while a value is parsed like the string streams, which
+// also leaves the caller's copy at the start of a number while the handler
+// sees it, see JsonExactHandler
+template <>
+struct StreamTraits<MemoryStream> {
+    enum { copyOptimization = 1 };
+};
+}
+#endif
+
+namespace xpack {
+
+/*
+  How json numbers are converted, set on JsonEncoder, JsonDecoder and
+  JsonSaxDecoder, or passed to the json:: functions.
+
+  kJsonNumberDefault: rapidjson's own conversions. Doubles are written with
+  Grisu2, which round-trips but is not always the shortest form, and parsed
+  with rapidjson's normal precision strtod, which may be a few ULP off.
+
+  kJsonNumberExact: doubles are written in the shortest form that round-trips
+  (std::to_chars, floats as floats) and parsed correctly rounded: the reader
+  runs as in the default mode and JsonExactHandler parses the text of every
+  double again with std::from_chars, straight from the input. Without
+  <charconv> support (X_PACK_SUPPORT_CHARCONV) writing stays on Grisu2 and
+  parsing uses rapidjson's full precision strtod, which can take up to
+  twice as long as the default.
+*/
+enum JsonNumberMode {
+    kJsonNumberDefault,
+    kJsonNumberExact
+};
+
+#ifdef X_PACK_SUPPORT_CHARCONV
+class JsonNumber {
+public:
+    // enough for any float or double in shortest form
+    static const size_t kMaxChars = 32;
+
+    // shortest round-trip text of a finite val, false for NaN and infinity.
+    // Integral values keep a ".0" the way rapidjson writes them.
+    template <class T>
+    static bool Shortest(T val, char *buf, size_t &length) {
+        if (!std::isfinite(val)) {
+            return false;
+        }
+        std::to_chars_result r = std::to_chars(buf, buf+kMaxChars-2, val);
+        length = (size_t)(r.ptr-buf);
+        bool integral = true;
+        for (size_t i=0; i<length; ++i) {
+            if (buf[i] == '.' || buf[i] == 'e') {
+                integral = false;
+                break;
+            }
+        }
+        if (integral) {
+            buf[length++] = '.';
+            buf[length++] = '0';
+        }
+        return true;
+    }
+
+    // the json number at p correctly rounded, d if it is not finite (NaN and
+    // infinity are parsed by rapidjson). end is NULL for NUL terminated text.
+    static double Parse(const char *p, const char *end, double d) {
+        if (!std::isfinite(d)) {
+            return d;
+        }
+        const char *q = p;
+        while (q != end && ((*q >= '0' && *q <= '9') || *q == '-' || *q == '+' || *q == '.' || *q == 'e' || *q == 'E')) {
+            ++q;
+        }
+        double val;
+        if (std::from_chars(p, q, val).ec != std::errc()) {
+            return d; // out of range, rapidjson's value is as good
+        }
+        return val;
+    }
+};
+
+/*
+  rapidjson handler that forwards to H with doubles parsed by
+  JsonNumber::Parse. The reader copies streams with copyOptimization into a
+  local while it parses a number, so is still points at the number's text
+  when Double is called. Only string and memory streams, which have it, can
+  be used.
+*/
+template <class H, class Stream>
+class JsonExactHandler {
+public:
+    JsonExactHandler(H &h, const Stream &is):_h(h), _is(is) {}
+
+    bool Null() { return _h.Null(); }
+    bool Bool(bool b) { return _h.Bool(b); }
+    bool Int(int i) { return _h.Int(i); }
+    bool Uint(unsigned u) { return _h.Uint(u); }
+    bool Int64(int64_t i) { return _h.Int64(i); }
+    bool Uint64(uint64_t u) { return _h.Uint64(u); }
+    bool Double(double d) { return _h.Double(JsonNumber::Parse(_is.src_, End(_is), d)); }
+    bool RawNumber(const char *str, rapidjson::SizeType length, bool copy) { return _h.RawNumber(str, length, copy); }
+    bool String(const char *str, rapidjson::SizeType length, bool copy) { return _h.String(str, length, copy); }
+    bool StartObject() { return _h.StartObject(); }
+    bool Key(const char *str, rapidjson::SizeType length, bool copy) { return _h.Key(str, length, copy); }
+    bool EndObject(rapidjson::SizeType count) { return _h.EndObject(count); }
+    bool StartArray() { return _h.StartArray(); }
+    bool EndArray(rapidjson::SizeType count) { return _h.EndArray(count); }
+
+private:
+    static const char *End(const rapidjson::MemoryStream &is) {
+        return is.end_;
+    }
+    template <class S>
+    static const char *End(const S &is) {
+        (void)is;
+        return NULL;
+    }
+
+    H &_h;
+    const Stream &_is;
+};
+#endif
+
+}
+
+#endif
@@ -0,0 +1,739 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_JSON_SAX_DECODER_H
+#define __X_PACK_JSON_SAX_DECODER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+
+#include "rapidjson_custom.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/document.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/error/en.h"
+
+#include "xdecoder.h"
+#include "json_decoder.h"
+#include "json_arena.h"
+#include "field_index.h"
+#include "json_number.h"
+
+#ifdef RAPIDJSON_SIMD
+namespace rapidjson {
+// the decoder reads a bare MemoryStream, rapidjson only has the SIMD whitespace
+// skip for EncodedInputStream<UTF8<>, MemoryStream>
+template<> inline void SkipWhitespace(MemoryStream& is) {
+    is.src_ = SkipWhitespace_SIMD(is.src_, is.end_);
+}
+}
+#endif
+
+namespace xpack {
+
+/*
+  Streaming json decoder. Tokens are pulled from rapidjson::Reader one at a
+  time and written straight into the target, so no rapidjson::Document is
+  built and peak memory does not depend on the size of the input.
+
+  Every member key of a json object is looked up in the FieldIndex of the
+  struct, members without a field are skipped. Plain fields are decoded
+  straight through the thunk recorded in the index. For bitfields and fields
+  of custom codecs __x_pack_decode runs once in "dispatch" mode, where only
+  the field with the number found in the index consumes the value, which
+  costs a visit of every field of the struct per member. Once the object
+  ends, __x_pack_decode runs again to check mandatory fields.
+
+  Results match JsonDecoder, with two exceptions: if several fields share a
+  json name only the first one is filled, and xtype/JsonData members are
+  decoded through a rapidjson::Document that holds just that member.
+  Qt types are not supported.
+*/
+class JsonSaxDecoder {
+public:
+    // stack: memory for the parser stack, see JsonArena::Scope. A pool owned
+    // by the decoder is used if it is NULL.
+    JsonSaxDecoder(const char *data, size_t length, JsonArena::Allocator *stack = NULL)
+        :_is(data, length), _stack(kStackChunk), _reader(NULL != stack ? stack : &_stack), _handler(_token), _frame(NULL), _numberMode(kJsonNumberDefault) {
+        // skip the UTF-8 BOM here rather than going through EncodedInputStream,
+        // which costs a lot per character
+        if (length >= 3 && 0 == memcmp(data, "\xEF\xBB\xBF", 3)) {
+            _is.src_ += 3;
+        }
+        _reader.IterativeParseInit();
+    }
+
+    // see JsonNumberMode, set it before decoding
+    void SetNumberMode(JsonNumberMode mode) {
+        _numberMode = mode;
+    }
+
+    inline static const char * Name() {
+        return "json";
+    }
+
+    // parse a whole document into val
+    template <class T>
+    bool decode_document(T &val) {
+        try {
+            next();
+            bool ret = this->decode_type(val, NULL);
+            if (!_reader.IterativeParseComplete()) {
+                // trailing data, or a scalar root that has not been finished yet
+                next();
+            }
+            return ret;
+        } catch (const PathError &e) {
+            throw std::runtime_error(e.what+". (path:"+e.path+")");
+        }
+    }
+
+    ////////////// called by code generated by XPACK //////////////
+
+    // field of the object being decoded
+    template <class T>
+    bool decode(const char*key, T&val, const Extend*ext) {
+        Frame *f = _frame;
+        if (NULL == f) {
+            decode_exception("not object", key);
+        }
+
+        size_t index = f->next++;
+        if (f->checking) {
+            if (Extend::Mandatory(ext) && !f->seen(index)) {
+                decode_exception("mandatory key not found", key);
+            }
+            return false;
+        }
+        // the name is compared as well in case a custom codec does not visit
+        // the fields the way the index recorded them.
+        // first member wins if the key is duplicated, like FindMember
+        if (f->matched || (f->field != FieldIndex::npos && f->field != index)
+            || 0 != strcmp(key, f->key.c_str()) || f->seen(index)) {
+            return false;
+        }
+
+        f->matched = true;
+        f->mark(index);
+        return this->decode_child(val, ext, key, -1);
+    }
+
+    // field with an offset in the FieldIndex, decoded without __x_pack_decode
+    template <class T>
+    static bool decode_thunk(void *decoder, void *field, const Extend*ext, const char *key) {
+        return static_cast<JsonSaxDecoder*>(decoder)->decode_child(*static_cast<T*>(field), ext, key, -1);
+    }
+
+    // inherited XPACK struct, or the current value (custom codec)
+    template <class T>
+    bool decode(T &val, const Extend*ext) {
+        if (0 != (X_PACK_CTRL_FLAG_INHERIT&Extend::CtrlFlag(ext))) {
+            return this->decode_fields(val, ext);
+        }
+        return this->decode_type(val, ext);
+    }
+
+    void decode_exception(const char* what, const char *key) const {
+        PathError e;
+        if (NULL != what) {
+            e.what = what;
+        }
+        if (NULL != key) {
+            e.path = key;
+        }
+        throw e;
+    }
+
+private:
+    static const unsigned kParseFlags = rapidjson::kParseNanAndInfFlag;
+    static const unsigned kExactFlags = kParseFlags|rapidjson::kParseFullPrecisionFlag;
+
+    struct Token {
+        enum Type {
+            kNone,
+            kNull,
+            kBool,
+            kInt,       // negative integer
+            kUint,      // non-negative integer
+            kDouble,
+            kString,
+            kKey,
+            kStartObject,
+            kEndObject,
+            kStartArray,
+            kEndArray
+        };
+
+        Type type;
+        bool b;
+        int64_t i;
+        uint64_t u;
+        double d;
+        std::string str;
+    };
+
+    // rapidjson handler, stores the last event in a Token
+    class Handler {
+    public:
+        Handler(Token &token):copy(true), t(token) {}
+
+        bool Null() { t.type = Token::kNull; return true; }
+        bool Bool(bool b) { t.type = Token::kBool; t.b = b; return true; }
+        bool Int(int i) { return Int64(i); }
+        bool Uint(unsigned u) { return Uint64(u); }
+        bool Int64(int64_t i) { t.type = Token::kInt; t.i = i; return true; }
+        bool Uint64(uint64_t u) { t.type = Token::kUint; t.u = u; return true; }
+        bool Double(double d) { t.type = Token::kDouble; t.d = d; return true; }
+        bool RawNumber(const char* str, rapidjson::SizeType length, bool) { return String(str, length, true); }
+        bool String(const char* str, rapidjson::SizeType length, bool) {
+            t.type = Token::kString;
+            if (copy) {
+                t.str.assign(str, length);
+            }
+            return true;
+        }
+        bool Key(const char* str, rapidjson::SizeType length, bool c) {
+            String(str, length, c);
+            t.type = Token::kKey;
+            return true;
+        }
+        bool StartObject() { t.type = Token::kStartObject; return true; }
+        bool EndObject(rapidjson::SizeType) { t.type = Token::kEndObject; return true; }
+        bool StartArray() { t.type = Token::kStartArray; return true; }
+        bool EndArray(rapidjson::SizeType) { t.type = Token::kEndArray; return true; }
+
+        bool copy;  // false while skipping values
+    private:
+        Token &t;
+    };
+
+    // object being decoded
+    struct Frame {
+        Frame(Frame *p):parent(p), field(FieldIndex::npos), next(0), matched(false), checking(false), bits(0) {}
+
+        bool seen(size_t index) const {
+            if (index < 64) {
+                return 0 != (bits&(uint64_t(1)<<index));
+            }
+            return index-64 < more.size() && more[index-64];
+        }
+        void mark(size_t index) {
+            if (index < 64) {
+                bits |= uint64_t(1)<<index;
+            } else {
+                if (more.size() <= index-64) {
+                    more.resize(index-64+1);
+                }
+                more[index-64] = true;
+            }
+        }
+
+        Frame *parent;
+        std::string key;    // current member key
+        size_t field;       // field of the current member, npos to match by name
+        size_t next;        // index of the next field visited by __x_pack_decode
+        bool matched;       // a field took the current member
+        bool checking;      // check mandatory fields
+        uint64_t bits;      // fields that have been decoded
+        std::vector<bool> more;
+    };
+
+    // Thrown by decode_exception. The path is filled in while the exception
+    // unwinds, so nothing has to be tracked while decoding succeeds.
+    struct PathError {
+        std::string what;
+        std::string path;
+
+        void prepend(const char *key, int index) {
+            std::string node;
+            if (NULL != key) {
+                node = key;
+                if (!path.empty() && path[0] != '[') {
+                    node.append(".");
+                }
+            } else {
+                node.append("[").append(Util::itoa(index)).append("]");
+                if (!path.empty() && path[0] != '[') {
+                    node.append(".");
+                }
+            }
+            path.insert(0, node);
+        }
+    };
+
+    // forwards the events of one value to a rapidjson::Document, see decode_dom
+    template <class H>
+    class Forwarder {
+    public:
+        Forwarder(H &h):depth(0), _h(h) {}
+
+        bool Null() { return _h.Null(); }
+        bool Bool(bool b) { return _h.Bool(b); }
+        bool Int(int i) { return _h.Int(i); }
+        bool Uint(unsigned u) { return _h.Uint(u); }
+        bool Int64(int64_t i) { return _h.Int64(i); }
+        bool Uint64(uint64_t u) { return _h.Uint64(u); }
+        bool Double(double d) { return _h.Double(d); }
+        bool RawNumber(const char* str, rapidjson::SizeType length, bool c) { return _h.RawNumber(str, length, c); }
+        bool String(const char* str, rapidjson::SizeType length, bool c) { return _h.String(str, length, c); }
+        bool Key(const char* str, rapidjson::SizeType length, bool c) { return _h.Key(str, length, c); }
+        bool StartObject() { ++depth; return _h.StartObject(); }
+        bool EndObject(rapidjson::SizeType n) { --depth; return _h.EndObject(n); }
+        bool StartArray() { ++depth; return _h.StartArray(); }
+        bool EndArray(rapidjson::SizeType n) { --depth; return _h.EndArray(n); }
+
+        int depth;
+    private:
+        H &_h;
+    };
+
+    class Generator {
+    public:
+        Generator(JsonSaxDecoder &d):de(d) {}
+
+        template <class H>
+        bool operator()(H &h) {
+            Forwarder<H> fwd(h);
+            de.replay(fwd);
+            while (fwd.depth > 0) {
+                if (!de.parse_next(fwd)) {
+                    de.parse_exception();
+                }
+            }
+            return true;
+        }
+    private:
+        JsonSaxDecoder &de;
+    };
+
+    ///////////////////// tokens //////////////////////
+    template <class H>
+    bool parse_next(H &h) {
+        if (_numberMode == kJsonNumberExact) {
+            #ifdef X_PACK_SUPPORT_CHARCONV
+            JsonExactHandler<H, rapidjson::MemoryStream> exact(h, _is);
+            return _reader.template IterativeParseNext<kParseFlags>(_is, exact);
+            #else
+            return _reader.template IterativeParseNext<kExactFlags>(_is, h);
+            #endif
+        }
+        return _reader.template IterativeParseNext<kParseFlags>(_is, h);
+    }
+    void next() {
+        _token.type = Token::kNone;
+        if (!parse_next(_handler)) {
+            parse_exception();
+        }
+        if (_token.type == Token::kNone && !_reader.IterativeParseComplete()) {
+            decode_exception("unexpected end of json", NULL);
+        }
+    }
+
+    // skip the current value
+    void skip() {
+        if (_token.type != Token::kStartObject && _token.type != Token::kStartArray) {
+            return;
+        }
+
+        _handler.copy = false;
+        int depth = 1;
+        while (depth > 0) {
+            next();
+            if (_token.type == Token::kStartObject || _token.type == Token::kStartArray) {
+                ++depth;
+            } else if (_token.type == Token::kEndObject || _token.type == Token::kEndArray) {
+                --depth;
+            }
+        }
+        _handler.copy = true;
+    }
+
+    // send the current token to h
+    template <class H>
+    void replay(H &h) {
+        switch (_token.type) {
+        case Token::kNull: h.Null(); break;
+        case Token::kBool: h.Bool(_token.b); break;
+        case Token::kInt: h.Int64(_token.i); break;
+        case Token::kUint: h.Uint64(_token.u); break;
+        case Token::kDouble: h.Double(_token.d); break;
+        case Token::kString: h.String(_token.str.data(), (rapidjson::SizeType)_token.str.length(), true); break;
+        case Token::kStartObject: h.StartObject(); break;
+        case Token::kStartArray: h.StartArray(); break;
+        default: decode_exception("unexpected token", NULL);
+        }
+    }
+
+    void parse_exception() const {
+        std::string parse_err(rapidjson::GetParseError_En(_reader.GetParseErrorCode()));
+        size_t offset = _reader.GetErrorOffset();
+        size_t size = _is.size_;
+        std::string err_data(_is.begin_+(offset<size?offset:size), offset<size?(size-offset<32?size-offset:32):0);
+        throw std::runtime_error("Parse json fail. err="+parse_err+". offset="+err_data);
+    }
+
+    // decode the current value, which is member key or element index of its parent
+    template <class T>
+    bool decode_child(T &val, const Extend*ext, const char *key, int index) {
+        try {
+            return this->decode_type(val, ext);
+        } catch (PathError &e) {
+            e.prepend(key, index);
+            throw;
+        }
+    }
+
+    ///////////////////// values //////////////////////
+    // numeric
+    template <class T>
+    typename x_enable_if<numeric<T>::is_integer, bool>::type decode_type(T &val, const Extend*ext) {
+        (void)ext;
+        switch (_token.type) {
+        case Token::kInt: val = (T)_token.i; break;
+        case Token::kUint: val = (T)_token.u; break;
+        case Token::kNull: val = 0; break;
+        default: decode_exception("not integer", NULL);
+        }
+        return true;
+    }
+    template <class T>
+    typename x_enable_if<numeric<T>::is_float, bool>::type decode_type(T &val, const Extend*ext) {
+        (void)ext;
+        switch (_token.type) {
+        case Token::kInt: val = (T)(double)_token.i; break;
+        case Token::kUint: val = (T)(double)_token.u; break;
+        case Token::kDouble: val = (T)_token.d; break;
+        case Token::kNull: val = 0; break;
+        default: decode_exception("not number", NULL);
+        }
+        return true;
+    }
+    bool decode_type(bool &val, const Extend*ext) {
+        (void)ext;
+        switch (_token.type) {
+        case Token::kBool: val = _token.b; break;
+        case Token::kInt: val = (0 != _token.i); break;
+        case Token::kNull: val = false; break;
+        // like rapidjson::Value::IsInt64
+        case Token::kUint:
+            if (_token.u > (uint64_t)INT64_MAX) {
+                decode_exception("not bool or integer", NULL);
+            }
+            val = (0 != _token.u);
+            break;
+        default: decode_exception("not bool or integer", NULL);
+        }
+        return true;
+    }
+    // std::string. The token buffer is swapped in, so long strings are not copied again.
+    bool decode_type(std::string &val, const Extend*ext) {
+        (void)ext;
+        if (_token.type == Token::kString) {
+            val.swap(_token.str);
+        } else if (_token.type != Token::kNull) {
+            decode_exception("not string", NULL);
+        }
+        return true;
+    }
+    #ifdef X_PACK_SUPPORT_CXX17
+    // tokens are copied out of the input, so there is nothing a view could
+    // point to once the decode is done
+    template <class T>
+    typename x_enable_if<std::is_same<T, std::string_view>::value, bool>::type decode_type(T &val, const Extend*ext) {
+        static_assert(sizeof(T) == 0, "std::string_view members need xpack::json::decode with a JsonInsitu");
+        return false;
+    }
+    #endif
+    #ifdef X_PACK_SUPPORT_CXX20
+    template <class T>
+    typename x_enable_if<std::is_same<T, std::span<const char> >::value, bool>::type decode_type(T &val, const Extend*ext) {
+        static_assert(sizeof(T) == 0, "std::span members need xpack::json::decode with a JsonInsitu");
+        return false;
+    }
+    #endif
+    // array
+    template <class T, size_t N>
+    bool decode_type(T (&val)[N], const Extend*ext) {
+        return this->decode_array(val, N, ext);
+    }
+    // vector
+    template <class T>
+    bool decode_type(std::vector<T> &val, const Extend*ext) {
+        return this->decode_vector(val, ext);
+    }
+    // list
+    template <class T>
+    bool decode_type(std::list<T> &val, const Extend*ext) {
+        return this->decode_list<std::list<T>, T>(val, ext);
+    }
+    // set
+    template <class T>
+    bool decode_type(std::set<T> &val, const Extend*ext) {
+        return this->decode_list<std::set<T>, T>(val, ext);
+    }
+    // map
+    template <class K, class V>
+    bool decode_type(std::map<K, V> &val, const Extend*ext) {
+        return this->decode_map<std::map<K, V>, K, V>(val, ext);
+    }
+    // unordered_map
+    template <class K, class V>
+    bool decode_type(std::unordered_map<K, V> &val, const Extend*ext) {
+        return this->decode_map<std::unordered_map<K, V>, K, V>(val, ext);
+    }
+    // shared_ptr
+    template <class T>
+    bool decode_type(std::shared_ptr<T> &val, const Extend*ext) {
+        bool ret = false;
+        if (_token.type != Token::kNull) {
+            val.reset(new T);
+            ret = this->decode_type(*val, ext);
+            if (!ret) {
+                val.reset();
+            }
+        }
+        return ret;
+    }
+    // enum
+    template <class T>
+    typename x_enable_if<std::is_enum<T>::value && !is_xpack_xtype<T>::value, bool>::type decode_type(T &val, const Extend*ext) {
+        typename std::underlying_type<T>::type tmp;
+        bool ret = this->decode_type(tmp, ext);
+        if (ret) {
+            val = (T)tmp;
+        }
+        return ret;
+    }
+    template <class T>
+    typename x_enable_if<std::is_pointer<T>::value, bool>::type decode_type(T &val, const Extend*ext) {
+        static_assert(!std::is_pointer<T>::value, "not support pointer, use shared_ptr please");
+        (void)val;(void)ext;
+        return false;
+    }
+    // XPACK or XPACK_OUT and not XTYPE
+    template <class T>
+    XPACK_IS_XOUT(T) decode_type(T &val, const Extend*ext) {
+        return this->decode_struct(val, ext);
+    }
+    template <class T>
+    XPACK_IS_XPACK(T) decode_type(T &val, const Extend*ext) {
+        return this->decode_struct(val, ext);
+    }
+    // xtype and JsonData
+    template <class T>
+    XPACK_IS_XTYPE(JsonNode, T) decode_type(T &val, const Extend*ext) {
+        return this->decode_dom(val, ext);
+    }
+    template <class T>
+    typename x_enable_if<is_xpack_type_spec<JsonNode, T>::value, bool>::type decode_type(T &val, const Extend*ext) {
+        return this->decode_dom(val, ext);
+    }
+
+    template <class T>
+    typename x_enable_if<T::__x_pack_value && !is_xpack_out<T>::value, bool>::type decode_fields(T &val, const Extend*ext) {
+        return val.__x_pack_decode(*this, val, ext);
+    }
+    template <class T>
+    typename x_enable_if<is_xpack_out<T>::value, bool>::type decode_fields(T &val, const Extend*ext) {
+        return __x_pack_decode_out(*this, val, ext);
+    }
+
+    template <class T>
+    bool decode_struct(T &val, const Extend*ext) {
+        const FieldIndex &index = FieldIndex::Get<T, JsonSaxDecoder>();
+        Frame frame(_frame);
+        _frame = &frame;
+
+        bool ret = false;
+        if (_token.type == Token::kStartObject) {
+            for (next(); _token.type != Token::kEndObject; next()) {
+                frame.key.swap(_token.str);
+                next();
+
+                frame.field = index.Find(frame.key.data(), frame.key.length());
+                if (frame.field == FieldIndex::npos || frame.seen(frame.field)) {
+                    skip();
+                    continue;
+                }
+
+                const FieldIndex::Field &field = index.At(frame.field);
+                if (NULL != field.thunk) {
+                    frame.mark(frame.field);
+                    ret |= field.thunk(this, (char*)&val+field.offset, &field.ext, field.name.c_str());
+                    continue;
+                }
+
+                frame.next = 0;
+                frame.matched = false;
+                ret |= this->decode_fields(val, ext);
+                if (!frame.matched) {
+                    // not visited at the recorded number, fall back to the name
+                    frame.field = FieldIndex::npos;
+                    frame.next = 0;
+                    ret |= this->decode_fields(val, ext);
+                    if (!frame.matched) {
+                        skip();
+                    }
+                }
+            }
+        } else if (_token.type != Token::kNull) {
+            decode_exception("not object", NULL);
+        }
+
+        frame.checking = true;
+        frame.next = 0;
+        this->decode_fields(val, ext);
+
+        _frame = frame.parent;
+        return ret;
+    }
+
+    template <class T>
+    bool decode_array(T *val, size_t N, const Extend*ext) {
+        if (_token.type == Token::kNull) {
+            return true;
+        } else if (_token.type != Token::kStartArray) {
+            decode_exception("not array", NULL);
+        }
+
+        size_t i = 0;
+        for (next(); _token.type != Token::kEndArray; next(), ++i) {
+            if (i < N) {
+                this->decode_child(val[i], ext, NULL, (int)i);
+            } else {
+                skip();
+            }
+        }
+        return true;
+    }
+    // char[] is special
+    bool decode_array(char *val, size_t N, const Extend*ext) {
+        std::string str;
+        bool ret = this->decode_type(str, ext);
+        if (ret) {
+            size_t mx = str.length();
+            mx = mx>N-1?N-1:mx;
+            memcpy(val, str.data(), mx);
+            val[mx] = '\0';
+        }
+        return ret;
+    }
+    template <class Vector>
+    bool decode_vector(Vector &val, const Extend*ext) {
+        size_t i = 0;
+        if (_token.type == Token::kStartArray) {
+            for (next(); _token.type != Token::kEndArray; next(), ++i) {
+                if (i >= val.size()) {
+                    val.resize(i+1);
+                }
+                this->decode_child(val[i], ext, NULL, (int)i);
+            }
+        } else if (_token.type != Token::kNull) {
+            decode_exception("not array", NULL);
+        }
+        val.resize(i);
+        return true;
+    }
+    template <class List, class Elem>
+    bool decode_list(List &val, const Extend*ext) {
+        if (_token.type == Token::kNull) {
+            return true;
+        } else if (_token.type != Token::kStartArray) {
+            decode_exception("not array", NULL);
+        }
+
+        int i = 0;
+        for (next(); _token.type != Token::kEndArray; next(), ++i) {
+            Elem _t;
+            this->decode_child(_t, ext, NULL, i);
+            this->add_ele(val, _t);
+        }
+        return true;
+    }
+    template <class Map, class K, class V>
+    bool decode_map(Map &val, const Extend*ext) {
+        if (_token.type != Token::kStartObject) {
+            decode_exception("not object", NULL);
+        }
+
+        std::string key;
+        for (next(); _token.type != Token::kEndObject; next()) {
+            key.swap(_token.str);
+            next();
+
+            K k;
+            if (!keyConvert(key, k)) {
+                skip();
+                continue;
+            }
+            V v;
+            if (this->decode_child(v, ext, key.c_str(), -1)) {
+                val[k] = std::move(v);
+            }
+        }
+        return true;
+    }
+
+    // decode the current value through a rapidjson::Document
+    template <class T>
+    bool decode_dom(T &val, const Extend*ext) {
+        rapidjson::Document doc;
+        Generator g(*this);
+        doc.Populate(g);
+
+        JsonNode node(&doc);
+        return XDecoder<JsonNode>(NULL, (const char*)NULL, node).decode(val, ext);
+    }
+
+    template <class T>
+    inline void add_ele(std::list<T>&val, T &t) {
+        val.push_back(std::move(t));
+    }
+    template <class T>
+    inline void add_ele(std::set<T>&val, T &t) {
+        val.insert(std::move(t));
+    }
+
+    inline bool keyConvert(const std::string&s, std::string&key) {
+        key = s;
+        return true;
+    }
+    template <class T>
+    typename x_enable_if<std::is_enum<T>::value, bool>::type keyConvert(const std::string&s, T&key) {
+        return Util::atoi(s, key);
+    }
+    template <class T>
+    inline typename x_enable_if<numeric<T>::is_integer, bool>::type keyConvert(const std::string&s, T&key) {
+        return Util::atoi(s, key);
+    }
+
+    static const size_t kStackChunk = 1024;
+
+    rapidjson::MemoryStream _is;
+    JsonArena::Allocator _stack;
+    rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, JsonArena::Allocator> _reader;
+    Token _token;
+    Handler _handler;
+    Frame *_frame;
+    JsonNumberMode _numberMode;
+};
+
+}
+
+#endif
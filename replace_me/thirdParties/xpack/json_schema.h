@@ -0,0 +1,152 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_JSON_SCHEMA_H
+#define __X_PACK_JSON_SCHEMA_H
+
+#include <string.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "rapidjson_custom.h"
+#include "rapidjson/document.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/schema.h"
+#include "rapidjson/error/en.h"
+
+#include "decode_result.h"
+#include "json_arena.h"
+#include "util.h"
+
+namespace xpack {
+
+/*
+  A json schema (draft 4, see rapidjson/schema.h) compiled once into a
+  rapidjson::SchemaDocument. The compiled schema is only read while
+  validating, so one instance can be shared by all threads.
+
+  Parse checks the text against the schema while rapidjson parses it: the
+  validator sits between the reader and the document, so there is a single
+  pass over the text, and the parse stops at the first value that does not
+  match. Nothing has been decoded into a struct by then, and the failure is
+  recorded in a DecodeResult rather than thrown.
+*/
+class JsonSchema {
+public:
+    typedef rapidjson::GenericSchemaValidator<rapidjson::SchemaDocument, JsonArena::Document, JsonArena::Allocator> Validator;
+
+    // throws std::runtime_error if schema is not valid json
+    explicit JsonSchema(const char *schema):_doc(Compile(_source, schema)) {
+    }
+
+    const rapidjson::SchemaDocument& Document() const {
+        return _doc;
+    }
+
+    // Parses NUL terminated text into doc. stack holds the parser and the
+    // validator state, see JsonArena::Scope. Returns false with the error in
+    // result if the text is not json (with the offset) or does not match the
+    // schema (with the path of the value and the failing keyword).
+    bool Parse(const char *text, JsonArena::Document &doc, JsonArena::Allocator &stack, DecodeResult &result) const {
+        if (0 == strncmp(text, "\xEF\xBB\xBF", 3)) {
+            text += 3;
+        }
+        rapidjson::StringStream is(text);
+        Generator gen(*this, is, stack, result);
+        doc.Populate(gen);
+        if (!result.Ok()) {
+            return false;
+        }
+        if (gen.parsed.IsError()) {
+            std::string err = "Parse json fail. err=";
+            err += rapidjson::GetParseError_En(gen.parsed.Code());
+            err += ". offset=";
+            size_t offset = gen.parsed.Offset();
+            size_t length = strlen(text);
+            if (offset < length) {
+                err.append(text+offset, length-offset < 32 ? length-offset : 32);
+            }
+            result.Fail(err, std::string(), offset);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    JsonSchema(const JsonSchema&);
+    JsonSchema& operator=(const JsonSchema&);
+
+    static const unsigned kParseFlags = rapidjson::kParseNanAndInfFlag;
+
+    // feeds the reader's events to the document through a validator
+    struct Generator {
+        Generator(const JsonSchema &s, rapidjson::StringStream &i, JsonArena::Allocator &a, DecodeResult &r):schema(s), is(i), stack(a), result(r) {}
+
+        bool operator()(JsonArena::Document &doc) {
+            rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, JsonArena::Allocator> reader(&stack);
+            Validator validator(schema._doc, doc, &stack);
+            parsed = reader.Parse<kParseFlags>(is, validator);
+            if (!validator.IsValid()) {
+                std::string what = "Schema validation fail. keyword=";
+                what += validator.GetInvalidSchemaKeyword();
+                result.Fail(what, Path(validator.GetInvalidDocumentPointer()));
+                return false;
+            }
+            return !parsed.IsError();
+        }
+
+        const JsonSchema &schema;
+        rapidjson::StringStream &is;
+        JsonArena::Allocator &stack;
+        DecodeResult &result;
+        rapidjson::ParseResult parsed;
+    };
+
+    // json pointer to the path format of decode errors: /items/3/id -> items[3].id
+    static std::string Path(const Validator::PointerType &pointer) {
+        std::string path;
+        for (size_t i=0; i<pointer.GetTokenCount(); ++i) {
+            const Validator::PointerType::Token &t = pointer.GetTokens()[i];
+            if (t.index != rapidjson::kPointerInvalidIndex) {
+                path.append("[").append(Util::itoa(t.index)).append("]");
+            } else {
+                if (!path.empty()) {
+                    path.append(".");
+                }
+                path.append(t.name, t.length);
+            }
+        }
+        return path;
+    }
+
+    static const rapidjson::Document& Compile(rapidjson::Document &doc, const char *schema) {
+        doc.Parse(schema);
+        if (doc.HasParseError()) {
+            std::string err = "Parse json schema fail. err=";
+            err += rapidjson::GetParseError_En(doc.GetParseError());
+            throw std::runtime_error(err);
+        }
+        return doc;
+    }
+
+    rapidjson::Document _source;   // kept for the lifetime of _doc
+    rapidjson::SchemaDocument _doc;
+};
+
+}
+
+#endif
@@ -15,5 +15,32 @@
 #define RAPIDJSON_WRITE_DEFAULT_FLAGS kWriteNanAndInfFlag
 #endif
 
+// SIMD whitespace skipping and string scanning. rapidjson picks its kernels at
+// compile time, so only instruction sets the build already targets are used:
+// SSE2 is part of x86-64 and NEON of arm64, SSE4.2 needs -msse4.2 (or a -march
+// that has it) or /arch:AVX. Define X_PACK_NO_SIMD to turn this off.
+//
+// The kernels load whole aligned 16-byte blocks and may read past the end of
+// the text (never past its page), which AddressSanitizer reports as an
+// overflow, so sanitized builds keep the scalar code.
+#if !defined(X_PACK_NO_SIMD) && defined(__has_feature)
+  #if __has_feature(address_sanitizer)
+    #define X_PACK_NO_SIMD
+  #endif
+#endif
+#if !defined(X_PACK_NO_SIMD) && defined(__SANITIZE_ADDRESS__)
+  #define X_PACK_NO_SIMD
+#endif
+
+#if !defined(X_PACK_NO_SIMD) && !defined(RAPIDJSON_SSE2) && !defined(RAPIDJSON_SSE42) && !defined(RAPIDJSON_NEON)
+  #if defined(__SSE4_2__) || (defined(_MSC_VER) && defined(__AVX__))
+    #define RAPIDJSON_SSE42
+  #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define RAPIDJSON_SSE2
+  #elif defined(__ARM_NEON) && !defined(_MSC_VER) // the NEON kernels use __builtin_clzll
+    #define RAPIDJSON_NEON
+  #endif
+#endif
+
 #endif
 
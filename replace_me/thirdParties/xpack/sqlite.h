@@ -18,6 +18,7 @@
 #define __X_PACK_SQLITE_H
 
 #include "sqlite_decoder.h"
+#include "sqlite_stmt_decoder.h"
 #include "xpack.h"
 
 namespace xpack {
@@ -37,6 +38,30 @@ public:
         SQLiteDecoder de(result, rows, cols);
         de.decode_column(field.c_str(), val, NULL);
     }
+
+    // Decodes the rows of a prepared statement, see SQLiteStmtDecoder. A
+    // struct val gets the first row and the statement is stepped only once;
+    // a vector<struct> gets every row, stepping to the end.
+    template <class T>
+    static void decode(sqlite3_stmt *stmt, T &val) {
+        SQLiteStmtDecoder de(stmt);
+        de.decode_top(val, NULL);
+    }
+
+    template <class T>
+    static void decode(sqlite3_stmt *stmt, const std::string&field, T &val) {
+        SQLiteStmtDecoder de(stmt);
+        de.decode_column(field.c_str(), val, NULL);
+    }
+
+    // Decodes the rows one at a time into row and calls callback(row) after
+    // each, so memory does not grow with the result. callback returns false
+    // to stop.
+    template <class T, class Callback>
+    static void decode_rows(sqlite3_stmt *stmt, T &row, Callback callback) {
+        SQLiteStmtDecoder de(stmt);
+        de.decode_rows(row, callback, NULL);
+    }
 };
 
 }
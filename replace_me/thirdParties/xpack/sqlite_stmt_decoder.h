@@ -0,0 +1,253 @@
+/*
+* Copyright (C) 2024 replace_me Authors. All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing,
+* software distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef __X_PACK_SQLITE_STMT_DECODER_H
+#define __X_PACK_SQLITE_STMT_DECODER_H
+
+#include <stdint.h>
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "extend.h"
+#include "traits.h"
+#include "json.h"
+
+namespace xpack {
+
+/*
+  Decodes the rows of a prepared statement while stepping it, instead of the
+  all-text result of sqlite3_get_table that SQLiteDecoder works on. Columns
+  are read in their storage class (sqlite3_column_int64/double/text/blob), so
+  numbers are not converted through text, and only the current row is held.
+
+  The column of each field is looked up on the first row and remembered in
+  the order the fields are decoded in, so later rows do not look up names.
+  Column names are copied after the first step: the step may re-prepare the
+  statement after a schema change, which frees the names read before it.
+
+  The statement is prepared, bound, reset and finalized by the caller. A
+  step that fails throws std::runtime_error with the sqlite error message.
+*/
+class SQLiteStmtDecoder {
+    friend class sqlite;
+public:
+    template <typename T>
+    bool decode(const char*key, T&val, const Extend *ext) {
+        int idx = this->column(key);
+        if (idx >= 0 && SQLITE_NULL != sqlite3_column_type(_stmt, idx)) {
+            return this->decode_type(idx, val, ext);
+        }
+        return false;
+    }
+    // inherited struct, I(Base)
+    template <typename T>
+    bool decode(T&val, const Extend *ext) {
+        return this->decode_struct(val, ext);
+    }
+    const char *Name() const { // mysql and sqlite use db
+        return "db";
+    }
+
+private:
+    typedef std::pair<const char*, int> Field;
+
+    sqlite3_stmt *_stmt;
+    std::map<std::string, int> _index;  // column of each name, from the first row
+    bool _indexed;
+    std::vector<Field> _fields;     // key and column, in decode order
+    size_t _field;                  // next in _fields
+
+    explicit SQLiteStmtDecoder(sqlite3_stmt *stmt):_stmt(stmt), _indexed(false), _field(0) {
+    }
+
+    void index() {
+        int cols = sqlite3_column_count(_stmt);
+        for (int i=0; i<cols; ++i) {
+            const char *name = sqlite3_column_name(_stmt, i);
+            if (NULL != name && _index.find(name) == _index.end()) {
+                _index[name] = i;
+            }
+        }
+        _indexed = true;
+    }
+
+    // false after the last row
+    bool step() {
+        int rc = sqlite3_step(_stmt);
+        if (SQLITE_ROW == rc) {
+            _field = 0;
+            if (!_indexed) {
+                this->index();
+            }
+            return true;
+        } else if (SQLITE_DONE == rc) {
+            return false;
+        }
+        std::string err = "sqlite3_step fail: ";
+        err += sqlite3_errmsg(sqlite3_db_handle(_stmt));
+        throw std::runtime_error(err);
+    }
+
+    // first row into a struct
+    template <class T>
+    bool decode_top(T& val, const Extend *ext) {
+        if (this->step()) {
+            this->decode_struct(val, ext);
+            return true;
+        }
+        return false;
+    }
+    // appends every row, reserve val to avoid reallocation
+    template <class T>
+    bool decode_top(std::vector<T>& val, const Extend *ext) {
+        while (this->step()) {
+            val.push_back(T());
+            this->decode_struct(val.back(), ext);
+        }
+        return true;
+    }
+    // decodes every row into row and passes it to callback, which returns
+    // false to stop early
+    template <class T, class Callback>
+    void decode_rows(T &row, Callback &callback, const Extend *ext) {
+        while (this->step()) {
+            row = T();
+            this->decode_struct(row, ext);
+            if (!callback(row)) {
+                break;
+            }
+        }
+    }
+
+    // special column of first row
+    template <class T>
+    bool decode_column(const char*field, T&val, const Extend *ext) {
+        return this->step() && this->decode(field, val, ext);
+    }
+    // special column of rows
+    template <class T>
+    bool decode_column(const char*field, std::vector<T>&val, const Extend *ext) {
+        if (!this->step()) {
+            return true;
+        }
+        int idx = this->find(field);
+        if (idx < 0) {
+            return false;
+        }
+        do {
+            val.push_back(T());
+            if (SQLITE_NULL != sqlite3_column_type(_stmt, idx)) {
+                this->decode_type(idx, val.back(), ext);
+            }
+        } while (this->step());
+        return true;
+    }
+
+    template <class T>
+    inline XPACK_IS_XPACK(T) decode_struct(T& val, const Extend *ext) {
+        return val.__x_pack_decode(*this, val, ext);
+    }
+    template <class T>
+    inline XPACK_IS_XOUT(T) decode_struct(T& val, const Extend *ext) {
+        return __x_pack_decode_out(*this, val, ext);
+    }
+
+    int find(const char*field) const {
+        std::map<std::string, int>::const_iterator it = _index.find(field);
+        if (it != _index.end()) {
+            return it->second;
+        }
+        return -1;
+    }
+    // column of the next field. Fields come in the same order on every row,
+    // so after the first row this is a pointer compare.
+    int column(const char *key) {
+        if (_field < _fields.size() && _fields[_field].first == key) {
+            return _fields[_field++].second;
+        }
+        // first row, or a custom codec that decodes other fields per row
+        _fields.resize(_field);
+        _fields.push_back(Field(key, this->find(key)));
+        return _fields[_field++].second;
+    }
+
+    // std::string
+    bool decode_type(const int idx, std::string &val, const Extend *ext) {
+        (void)ext;
+        const char *s;
+        if (SQLITE_BLOB == sqlite3_column_type(_stmt, idx)) {
+            s = (const char*)sqlite3_column_blob(_stmt, idx);
+        } else {
+            s = (const char*)sqlite3_column_text(_stmt, idx);
+        }
+        if (NULL != s) {
+            val.assign(s, (size_t)sqlite3_column_bytes(_stmt, idx));
+        }
+        return true;
+    }
+    // bool
+    bool decode_type(const int idx, bool &val, const Extend *ext) {
+        (void)ext;
+        val = (0 != sqlite3_column_int64(_stmt, idx));
+        return true;
+    }
+    // integer
+    template <class T>
+    typename x_enable_if<numeric<T>::is_integer, bool>::type decode_type(const int idx, T &val, const Extend *ext) {
+        (void)ext;
+        if (SQLITE_FLOAT == sqlite3_column_type(_stmt, idx)) {
+            val = (T)sqlite3_column_double(_stmt, idx);
+        } else {
+            val = (T)sqlite3_column_int64(_stmt, idx);
+        }
+        return true;
+    }
+    // float
+    template <class T>
+    typename x_enable_if<numeric<T>::is_float, bool>::type decode_type(const int idx, T &val, const Extend *ext) {
+        (void)ext;
+        val = (T)sqlite3_column_double(_stmt, idx);
+        return true;
+    }
+    // class/struct defined XPACK/XPACK_OUT, default use json to parse
+    template <class T>
+    inline XPACK_IS_XOUT(T) decode_type(const int idx, T &val, const Extend *ext) {
+        return this->decode_json(idx, val, ext);
+    }
+    template <class T>
+    inline XPACK_IS_XPACK(T) decode_type(const int idx, T &val, const Extend *ext) {
+        return this->decode_json(idx, val, ext);
+    }
+    template <class T>
+    bool decode_json(const int idx, T &val, const Extend *ext) {
+        (void)ext;
+        const char *s = (const char*)sqlite3_column_text(_stmt, idx);
+        if (NULL != s) {
+            xpack::json::decode(std::string(s, (size_t)sqlite3_column_bytes(_stmt, idx)), val);
+        }
+        return true;
+    }
+};
+
+}
+
+#endif
@@ -22,6 +22,24 @@
 #define X_PACK_SUPPORT_CXX0X 1
 #endif
 
+// std::string_view / std::span members
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define X_PACK_SUPPORT_CXX17 1
+#endif
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#define X_PACK_SUPPORT_CXX20 1
+#endif
+
+// std::to_chars/std::from_chars for floating point, see json_number.h
+#if defined(X_PACK_SUPPORT_CXX17) && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define X_PACK_SUPPORT_CHARCONV 1
+#endif
+#endif
+#endif
+
 namespace xpack {
 
 // implement std::enable_if
@@ -40,6 +58,16 @@ struct is_xpack_xtype {static bool const value = false;};
 template <class CODER, class T>
 struct is_xpack_type_spec {static bool const value = false;};
 
+// lives while a custom codec of C() decodes a field, see FieldIndex
+template <class DOC>
+struct CustomDecodeScope {
+    explicit CustomDecodeScope(DOC &doc) {(void)doc;}
+};
+
+// writers that take the quoted key of an O() field as is, see XEncoder::encode_field
+template <class WRITER>
+struct is_xpack_raw_key {static bool const value = false;};
+
 
 // for bitfield, declare raw type. thx https://stackoverflow.com/a/12199635/5845104
 template<int N> struct x_size { char value[N]; };
@@ -26,6 +26,7 @@
 
 #include "extend.h"
 #include "traits.h"
+#include "decode_result.h"
 
 #include "string.h"
 
@@ -37,9 +38,19 @@
 #endif
 
 #ifdef X_PACK_SUPPORT_CXX0X
+#include <atomic>
+#include <exception>
 #include <memory>
 #include <unordered_map>
 #include <type_traits>
+
+#include "decode_pool.h"
+#endif
+#ifdef X_PACK_SUPPORT_CXX17
+#include <string_view>
+#endif
+#ifdef X_PACK_SUPPORT_CXX20
+#include <span>
 #endif
 
 namespace xpack {
@@ -66,35 +77,43 @@ class XDecoder {
 public:
     typedef XDecoder<Node> decoder;
 
-    XDecoder(const decoder* parent, const char* key, Node node):_p(parent),_k(key),_i(-1),_n(node) {}
-    XDecoder(const decoder *parent, int index, Node node):_p(parent),_k(NULL),_i(index),_n(node) {}
-    XDecoder():_i(-2){}
+    XDecoder(const decoder* parent, const char* key, Node node):_p(parent),_k(key),_i(-1),_n(node),_r(NULL!=parent?parent->_r:NULL) {}
+    XDecoder(const decoder *parent, int index, Node node):_p(parent),_k(NULL),_i(index),_n(node),_r(NULL!=parent?parent->_r:NULL) {}
+    XDecoder():_i(-2),_r(NULL){}
+    // root of a try_decode: errors are recorded in result instead of thrown,
+    // see DecodeResult. Nodes must return an empty node, 0 or false after
+    // decode_exception, as it returns in this mode.
+    XDecoder(DecodeResult *result, Node node):_p(NULL),_k(NULL),_i(-1),_n(node),_r(result) {}
 
     const char *Name() const {
         return Node::Name();
     }
     void decode_exception(const char* what, const char *key) const {
-        std::string err;
-        err.reserve(128);
-        if (NULL != what) {
-            err.append(what);
-        }
-        err.append(". (path:");
-
         std::string p = path();
-        err.append(p);
         if (NULL != key) {
             if (!p.empty()) {
-                err.append(".");
+                p.append(".");
             }
-            err.append(key);
+            p.append(key);
+        }
+        if (NULL != _r) {
+            _r->FailDecode(NULL != what ? what : "", p);
+            return;
         }
 
-        err.append(")");
+        std::string err;
+        err.reserve(128);
+        if (NULL != what) {
+            err.append(what);
+        }
+        err.append(". (path:").append(p).append(")");
         throw std::runtime_error(err);
     }
     // find by key
     decoder Find(const char *key, const Extend *ext) {
+        if (this->failed()) {
+            return XDecoder();
+        }
         Node child = _n.Find(*this, key, ext);
         if (child){
             return XDecoder(this, key, child);
@@ -107,6 +126,10 @@ public:
     operator bool() const {
         return _i != -2;
     }
+    // a try_decode has failed, nothing more is decoded
+    bool failed() const {
+        return NULL != _r && !_r->Ok();
+    }
 
 public:
     template <class T>
@@ -157,6 +180,20 @@ private:
     inline bool decode_type(bool&val, const Extend *ext) {
         return _n.Get(*this, val, ext);
     }
+    #ifdef X_PACK_SUPPORT_CXX17
+    // view of a string in the decoded text, only for nodes that decode in situ
+    inline bool decode_type(std::string_view&val, const Extend *ext) {
+        return _n.Get(*this, val, ext);
+    }
+    #endif
+    #ifdef X_PACK_SUPPORT_CXX20
+    inline bool decode_type(std::span<const char>&val, const Extend *ext) {
+        std::string_view view(val.data(), val.size());
+        bool ret = _n.Get(*this, view, ext);
+        val = std::span<const char>(view.data(), view.size());
+        return ret;
+    }
+    #endif
     // array
     template <class T, size_t N>
     inline bool decode_type(T (&val)[N], const Extend *ext) {
@@ -274,7 +311,7 @@ private:
         size_t mx = _n.Size(*this);
         mx = mx>N?N:mx;
 
-        for (size_t i=0; i<mx; ++i) {
+        for (size_t i=0; i<mx && !this->failed(); ++i) {
             this->at(i, ext).decode_type(val[i], ext);
         }
         return true;
@@ -295,16 +332,76 @@ private:
     bool decode_vector(Vector &val, const Extend *ext) {
         size_t s = _n.Size(*this);
         val.resize(s);
-        for (size_t i=0; i<s; ++i) {
+        #ifdef X_PACK_SUPPORT_CXX0X
+        DecodePool *pool = DecodePool::Current();
+        // errors of a try_decode are recorded rather than thrown, so they
+        // cannot be collected from the pool threads
+        if (is_parallel_node<Node>::value && NULL != pool && NULL == _r && pool->Threads() > 1 && s >= pool->MinElements()) {
+            return this->decode_vector_parallel(*pool, val, s, ext);
+        }
+        #endif
+        for (size_t i=0; i<s && !this->failed(); ++i) {
             this->at(i, ext).decode_type(val[i], ext);
         }
         return true;
     }
+    #ifdef X_PACK_SUPPORT_CXX0X
+    template <class Vector>
+    struct ParallelVector {
+        decoder *self;
+        Vector *val;
+        const Extend *ext;
+        size_t size;
+        size_t tasks;
+        std::atomic<size_t> failed;             // first task that failed
+        std::vector<std::exception_ptr> errors;
+
+        static void Run(void *ctx, size_t task) {
+            ParallelVector &pv = *static_cast<ParallelVector*>(ctx);
+            size_t end = pv.size*(task+1)/pv.tasks;
+            for (size_t i=pv.size*task/pv.tasks; i<end; ++i) {
+                // tasks after a failed one are of no use, the ones before
+                // must finish to find the first failing element
+                if (task > pv.failed.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                try {
+                    pv.self->at(i, pv.ext).decode_type((*pv.val)[i], pv.ext);
+                } catch (...) {
+                    pv.errors[task] = std::current_exception();
+                    size_t f = pv.failed.load(std::memory_order_relaxed);
+                    while (task < f && !pv.failed.compare_exchange_weak(f, task)) {
+                    }
+                    return;
+                }
+            }
+        }
+    };
+    template <class Vector>
+    bool decode_vector_parallel(DecodePool &pool, Vector &val, size_t s, const Extend *ext) {
+        ParallelVector<Vector> pv;
+        pv.self = this;
+        pv.val = &val;
+        pv.ext = ext;
+        pv.size = s;
+        pv.tasks = std::min(pool.Threads()*4, s/(pool.MinElements()/4+1)+1);
+        pv.failed = (size_t)-1;
+        pv.errors.resize(pv.tasks);
+
+        DecodePool::Scope serial(NULL);   // nested arrays stay on their thread
+        pool.Run(pv.tasks, &ParallelVector<Vector>::Run, &pv);
+        size_t failed = pv.failed.load();
+        if (failed != (size_t)-1) {
+            std::rethrow_exception(pv.errors[failed]);
+        }
+        return true;
+    }
+    #endif
     // list
     template <class List, class Elem>
     bool decode_list(List &val, const Extend *ext) {
         size_t s = _n.Size(*this);
-        for (size_t i=0; i<s; ++i) {
+        for (size_t i=0; i<s && !this->failed(); ++i) {
             Elem _t;
             this->at(i, ext).decode_type(_t, ext);
             this->add_ele(val, _t);
@@ -317,10 +414,12 @@ private:
         typename Node::Iterator iter;
         std::string key;
         Node tmp = _n.Next(*this, _n, iter, key);
-        while (tmp) {
+        while (tmp && !this->failed()) {
             K k;
             V v;
-            if (keyConvert(key, k) && XDecoder(this, key.c_str(), tmp).decode_type(v, ext)) {
+            // the value first: keyConvert may take the key, which the path of
+            // a decode error points to
+            if (XDecoder(this, key.c_str(), tmp).decode_type(v, ext) && keyConvert(key, k)) {
                 val[k] = v;
             }
             tmp = tmp.Next(*this, _n, iter, key);
@@ -391,7 +490,7 @@ private:
                     k.append(".");
                 }
                 k.append(tmp->_k);
-            } else if (_i >= 0) {
+            } else if (tmp->_i >= 0) {
                 k.append("[").append(Util::itoa(tmp->_i)).append("]");
             }
             nodes.push_back(k);
@@ -409,6 +508,7 @@ private:
     const char* _k;
     int _i;
     Node _n;
+    DecodeResult *_r;   // try_decode only
 };
 
 }
@@ -39,6 +39,12 @@
 #include <unordered_map>
 #include <type_traits>
 #endif
+#ifdef X_PACK_SUPPORT_CXX17
+#include <string_view>
+#endif
+#ifdef X_PACK_SUPPORT_CXX20
+#include <span>
+#endif
 
 namespace xpack {
 
@@ -97,6 +103,18 @@ public:
         XPACK_WRITE_EMPTY(val.empty());
         return _w.encode_string(key, val, ext);
     }
+    #ifdef X_PACK_SUPPORT_CXX17
+    bool encode(const char*key, const std::string_view &val, const Extend *ext) {
+        std::string str(val);
+        return this->encode(key, str, ext);
+    }
+    #endif
+    #ifdef X_PACK_SUPPORT_CXX20
+    bool encode(const char*key, const std::span<const char> &val, const Extend *ext) {
+        std::string str(val.data(), val.size());
+        return this->encode(key, str, ext);
+    }
+    #endif
     template <class T>
     typename x_enable_if<numeric<T>::value, bool>::type encode(const char*key, const T&val, const Extend *ext) {
         XPACK_WRITE_EMPTY(val == 0);
@@ -223,6 +241,22 @@ public:
         return _w.encode_type_spec(key, val, ext);
     }
 
+    // field of O(), which has no flag or alias. Writers marked is_xpack_raw_key
+    // copy the quoted key to the output instead of escaping key; then the
+    // value is encoded without key. xtypes and type specs may write nothing,
+    // which would leave a dangling key, so they take the normal path.
+    template <class T>
+    inline typename x_enable_if<is_xpack_raw_key<Writer>::value && !is_xpack_xtype<T>::value && !is_xpack_type_spec<Writer, T>::value, bool>::type encode_field(const char*key, const char*quoted, size_t length, const T& val) {
+        (void)key;
+        _w.RawKey(quoted, length);
+        return this->encode((const char*)NULL, val, NULL);
+    }
+    template <class T>
+    inline typename x_enable_if<!is_xpack_raw_key<Writer>::value || is_xpack_xtype<T>::value || is_xpack_type_spec<Writer, T>::value, bool>::type encode_field(const char*key, const char*quoted, size_t length, const T& val) {
+        (void)quoted; (void)length;
+        return this->encode(key, val, NULL);
+    }
+
     // only for class/struct that defined XPACK
     template <class T>
     typename x_enable_if<T::__x_pack_value && !is_xpack_out<T>::value, bool>::type encode_struct(const char*key, const T& val, const Extend *ext) {
@@ -60,6 +60,15 @@ public:
         XmlDecoder de;
         de.decode_file(file_name, val);
     }
+    // Same as decode, but errors are returned instead of thrown, see
+    // DecodeResult. rapidxml still throws internally on a syntax error
+    template <class T>
+    static DecodeResult try_decode(const std::string &data, T &val) {
+        DecodeResult result;
+        XmlDecoder de;
+        de.decode(data, val, result);
+        return result;
+    }
     template <class T>
     static std::string encode(const T &val, const std::string&root) {
         XmlEncoder en;
@@ -27,6 +27,7 @@
 #include "rapidxml/rapidxml.hpp"
 
 #include "xdecoder.h"
+#include "file_mapping.h"
 
 namespace xpack {
 
@@ -211,41 +212,59 @@ public:
     template <class T>
     bool decode(const std::string&str, T&val, bool with_root=false) {
         std::string tmp = str;
-        return this->decode_indata(tmp, val, with_root);
+        return this->decode_indata((char*)tmp.c_str(), val, with_root, NULL);
+    }
+    // errors are recorded in result instead of thrown, see DecodeResult
+    template <class T>
+    bool decode(const std::string&str, T&val, DecodeResult &result, bool with_root=false) {
+        std::string tmp = str;
+        return this->decode_indata((char*)tmp.c_str(), val, with_root, &result);
     }
     template <class T>
     bool decode_file(const std::string&fname, T&val, bool with_root=false) {
+        // rapidxml parses in place and needs a NUL after the text, so map the
+        // file copy-on-write; only the pages rapidxml writes to are copied
+        FileMapping file;
+        if (file.Map(fname, true) && file.Terminated()) {
+            file.AdviseSequential();
+            return this->decode_indata(file.Data(), val, with_root, NULL);
+        }
         std::string data;
         bool ret = Util::readfile(fname, data);
         if (ret) {
-            ret = this->decode_indata(data, val, with_root);
+            ret = this->decode_indata((char*)data.c_str(), val, with_root, NULL);
         }
         return ret;
     }
 private:
     template <class T>
-    bool decode_indata(std::string&str, T&val, bool with_root=false) {
+    bool decode_indata(char *str, T&val, bool with_root, DecodeResult *result) {
         rapidxml::xml_document<> de;
         std::string err;
+        size_t offset = DecodeResult::npos;
         try {
-            de.parse<0>((char*)str.c_str());
+            de.parse<0>(str);
         } catch (const rapidxml::parse_error&e) {
             err = std::string("parse xml fail. err=")+e.what()+". "+std::string(e.where<char>()).substr(0, 32);
+            offset = (size_t)(e.where<char>()-str);
         } catch (const std::exception&e) {
             err = std::string("parse xml fail. unknow exception. err=")+e.what();
         }
 
         if (!err.empty()) {
+            if (NULL != result) {
+                result->Fail(err, std::string(), offset);
+                return false;
+            }
             throw std::runtime_error(err);
         }
 
-        if (!with_root) {
-            XmlNode node(de.first_node());
-            return XDecoder<XmlNode>(NULL, (const char*)NULL, node).decode(val, NULL);
-        } else { 
-            XmlNode node(&de);
+        XmlNode node(with_root ? &de : de.first_node());
+        if (NULL == result) {
             return XDecoder<XmlNode>(NULL, (const char*)NULL, node).decode(val, NULL);
         }
+        XDecoder<XmlNode>(result, node).decode(val, NULL);
+        return result->Ok();
     }
 };
 
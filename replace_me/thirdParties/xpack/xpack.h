@@ -82,7 +82,7 @@
 #define X_PACK_L1_ENCODE_AF(FLAG, ...)  X_EXPAND_FLAG_##FLAG X_PACK_N2(X_PACK_L2_2, X_PACK_ENCODE_ACT_A, 0, __VA_ARGS__) // extend define in ACTION
 #define X_PACK_L1_ENCODE_C(CUSTOM, FLAG, ...)   X_EXPAND_FLAG_##FLAG xpack::Extend __x_pack_ext(__x_pack_flag, NULL); X_PACK_N2(X_PACK_L2, X_PACK_ENCODE_ACT_C, CUSTOM, __VA_ARGS__)
 
-#define X_PACK_L1_ENCODE_O(...)         X_PACK_L1_ENCODE_X(F(0), __VA_ARGS__)
+#define X_PACK_L1_ENCODE_O(...)         X_PACK_N2(X_PACK_L2, X_PACK_ENCODE_ACT_PLAIN, 0, __VA_ARGS__)
 #define X_PACK_L1_ENCODE_M(...)         X_PACK_L1_ENCODE_X(F(M), __VA_ARGS__)
 #define X_PACK_L1_ENCODE_A(...)         X_PACK_L1_ENCODE_AF(F(0), __VA_ARGS__)
 //-----
@@ -94,7 +94,10 @@
         __x_pack_ret |= __x_pack_obj.decode(#M, __x_pack_self.M, &__x_pack_ext);
 
 #define X_PACK_DECODE_ACT_C(CUSTOM, M)                     \
-        __x_pack_ret |= CUSTOM##_decode(__x_pack_obj, __x_pack_self, #M, __x_pack_self.M, &__x_pack_ext);
+    {                                                      \
+        xpack::CustomDecodeScope<__X_PACK_DOC> __x_pack_scope(__x_pack_obj); \
+        __x_pack_ret |= CUSTOM##_decode(__x_pack_obj, __x_pack_self, #M, __x_pack_self.M, &__x_pack_ext); \
+    }
 
 // enum for not support c++11
 #ifndef X_PACK_SUPPORT_CXX0X
@@ -119,17 +122,24 @@
             __x_pack_ret |= __x_pack_obj.decode(static_cast<P&>(__x_pack_self), &__x_pack_tmp_ext);                  \
         }
 
-// bitfield, not support alias
+// bitfield, not support alias. Only assigned when decoded, as streaming
+// decoders visit every field once per json member.
 #define X_PACK_DECODE_ACT_B(ARG, B)                           \
     {                                                         \
         x_pack_decltype(__x_pack_self.B) __x_pack_tmp = 0;    \
-        __x_pack_ret |= __x_pack_obj.decode(#B, __x_pack_tmp, &__x_pack_ext); \
-        __x_pack_self.B = __x_pack_tmp;\
+        if (__x_pack_obj.decode(#B, __x_pack_tmp, &__x_pack_ext)) { \
+            __x_pack_self.B = __x_pack_tmp;                   \
+            __x_pack_ret = true;                              \
+        }                                                     \
     }
 
 // ~~~~~~~~~~~~~~~~~~~~~~~ encode act ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 #define X_PACK_ENCODE_ACT_O(ARG, M)                        \
         __x_pack_ret |= __x_pack_obj.encode(#M, __x_pack_self.M, &__x_pack_ext);
+// O(): no flag and no alias, so no Extend. The key is a C++ identifier, so its
+// quoted form needs no escaping and its length is known at compile time
+#define X_PACK_ENCODE_ACT_PLAIN(ARG, M)                    \
+        __x_pack_ret |= __x_pack_obj.encode_field(#M, "\"" #M "\"", sizeof("\"" #M "\"")-1, __x_pack_self.M);
 #define X_PACK_ENCODE_ACT_C(CUSTOM, M)                        \
         __x_pack_ret |= CUSTOM##_encode(__x_pack_obj, __x_pack_self, #M, __x_pack_self.M, &__x_pack_ext);
 
@@ -35,6 +35,15 @@ public:
         YamlDecoder de;
         de.decode_file(file_name, val);
     }
+    // Same as decode, but errors are returned instead of thrown, see
+    // DecodeResult. yaml-cpp still throws internally on a syntax error
+    template <class T>
+    static DecodeResult try_decode(const std::string &data, T &val) {
+        DecodeResult result;
+        YamlDecoder de;
+        de.decode(data, val, result);
+        return result;
+    }
 
     template <class T>
     static std::string encode(const T &val) {
@@ -46,12 +46,19 @@ public:
             return YamlNode();
         } else if (!n.IsMap()) {
             de.decode_exception("not map", NULL);
+            return YamlNode();
+        }
+        // a missing key gives an invalid node, which throws when it is read
+        YAML::Node child = n[key];
+        if (!child.IsDefined()) {
+            return YamlNode();
         }
-        return YamlNode(n[key]);
+        return YamlNode(child);
     }
     size_t Size(decoder&de) const {
         if (!n.IsSequence()) {
             de.decode_exception("not sequence", NULL);
+            return 0;
         }
         return (size_t)n.size();
     }
@@ -75,22 +82,43 @@ public:
         return YamlNode();
     }
 
+    // YAML::convert reports a mismatch by returning false, Node::as throws
     template <class T>
     bool Get(decoder&de, T &val, const Extend*ext){
-        (void)de;
         (void)ext;
-        try {
-            val = n.as<T>();
+        if (YAML::convert<T>::decode(n, val)) {
             return true;
-        } catch (const std::exception&e) {
-            de.decode_exception(e.what(), NULL);
-        } catch (...) {
-            de.decode_exception("type unmatch", NULL);
         }
+        this->bad_conversion(de);
         return false;
     }
+    // same as Node::as<std::string>
+    bool Get(decoder&de, std::string &val, const Extend*ext){
+        (void)ext;
+        if (n.IsNull()) {
+            val = "null";
+        } else if (n.IsScalar()) {
+            val = n.Scalar();
+        } else {
+            this->bad_conversion(de);
+            return false;
+        }
+        return true;
+    }
 
 private:
+    // the message of YAML::TypedBadConversion
+    void bad_conversion(decoder&de) const {
+        std::string err;
+        YAML::Mark mark = n.Mark();
+        if (!mark.is_null()) {
+            err.append("yaml-cpp: error at line ").append(Util::itoa(mark.line+1));
+            err.append(", column ").append(Util::itoa(mark.column+1)).append(": ");
+        }
+        err.append("bad conversion");
+        de.decode_exception(err.c_str(), NULL);
+    }
+
     YAML::Node n;
     bool valid;
 };
@@ -106,6 +134,23 @@ public:
         }
         return false;
     }
+    // errors are recorded in result instead of thrown, see DecodeResult
+    template <class T>
+    bool decode(const std::string&str, T&val, DecodeResult &result) {
+        YAML::Node n;
+        try {
+            n = YAML::Load(str);
+        } catch (const YAML::Exception &e) {
+            result.Fail(e.what(), std::string(), e.mark.is_null() ? DecodeResult::npos : (size_t)e.mark.pos);
+            return false;
+        }
+        if (n) {
+            YamlNode node(n);
+            XDecoder<YamlNode>(&result, node).decode(val, NULL);
+            return result.Ok();
+        }
+        return false;
+    }
     template <class T>
     bool decode_file(const std::string&fname, T&val) {
         YAML::Node n = YAML::LoadFile(fname);